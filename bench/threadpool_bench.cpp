@@ -0,0 +1,247 @@
+/** @file bench/threadpool_bench.cpp
+ *
+ * Threadpool for C++11, microbenchmark suite
+ *
+ * Measures queue throughput, per-task latency and the scaling of the
+ * one-shot algorithms, and writes the results as CSV to standard
+ * output so regressions can be tracked across releases:
+ *
+ *	benchmark,variant,threads,elements,metric,value,unit
+ *
+ * Run with `make bench`, which also stores the output in
+ * threadpool_bench.csv.
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <threadpool/threadpool.h>
+#include <threadpool/parallel_for_each.h>
+#include <threadpool/parallel_transform.h>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double microseconds_between(const Clock::time_point& t0,
+				const Clock::time_point& t1)
+    {
+	return std::chrono::duration<double, std::micro>(t1 - t0).count();
+    }
+
+    /**
+     * Write one CSV result row.
+     *
+     * @param benchmark
+     *		The name of the benchmark.
+     *
+     * @param variant
+     *		The benchmark-specific configuration, "-" if there
+     *		is only one.
+     *
+     * @param threads
+     *		The thread count used, -1 for the default.
+     *
+     * @param elements
+     *		The number of elements or tasks processed.
+     *
+     * @param metric
+     *		The name of the measured quantity.
+     *
+     * @param value
+     *		The measured value.
+     *
+     * @param unit
+     *		The unit of the measured value.
+     */
+    void report(const char* benchmark, const std::string& variant,
+		int threads, long long elements,
+		const char* metric, double value, const char* unit)
+    {
+	std::cout << benchmark << ',' << variant << ',' << threads << ','
+		  << elements << ',' << metric << ',' << value << ','
+		  << unit << '\n';
+    }
+
+
+
+    /**
+     * HQueue put()/help() throughput with a varying number of
+     * producers pushing no-op tasks into a running pool.
+     */
+    void bench_queue_throughput()
+    {
+	const int total = 200000;
+	const int producer_counts[] = { 1, 2, 4 };
+	for (int producers: producer_counts) {
+	    threadpool::ThreadPool pool;
+	    const int per_producer = total / producers;
+
+	    Clock::time_point t0 = Clock::now();
+	    std::vector<std::thread> ps;
+	    for (int p = 0; p != producers; ++p)
+		ps.emplace_back([&pool, per_producer]() {
+			for (int i = 0; i != per_producer; ++i)
+			    pool.run([](){});
+		    });
+	    for (std::thread& p: ps)
+		p.join();
+	    pool.wait();
+	    Clock::time_point t1 = Clock::now();
+
+	    double us = microseconds_between(t0, t1);
+	    long long n = static_cast<long long>(per_producer) * producers;
+	    report("hqueue_throughput",
+		   "producers=" + std::to_string(producers),
+		   -1, n, "us_per_task", us / n, "us");
+	}
+    }
+
+
+
+    /**
+     * Distribution of the submit-to-completion latency of a single
+     * no-op task on an otherwise idle pool.
+     */
+    void bench_run_latency()
+    {
+	const int samples = 20000;
+	threadpool::ThreadPool pool(1);
+	std::vector<double> latency(samples);
+
+	for (int i = 0; i != samples; ++i) {
+	    Clock::time_point t0 = Clock::now();
+	    pool.run([](){});
+	    pool.wait();
+	    latency[i] = microseconds_between(t0, Clock::now());
+	}
+
+	std::sort(latency.begin(), latency.end());
+	report("run_latency", "-", 1, samples, "p50_us",
+	       latency[samples / 2], "us");
+	report("run_latency", "-", 1, samples, "p90_us",
+	       latency[samples * 9 / 10], "us");
+	report("run_latency", "-", 1, samples, "p99_us",
+	       latency[samples * 99 / 100], "us");
+	report("run_latency", "-", 1, samples, "max_us",
+	       latency[samples - 1], "us");
+    }
+
+
+
+    /**
+     * parallel::for_each() scaling over element count for one thread
+     * count. The thread count is a template parameter of the free
+     * function, so the scaling curve is sampled at a fixed set of
+     * instantiations.
+     */
+    template<int thread_count>
+    void bench_for_each_scaling()
+    {
+	const long sizes[] = { 1000, 10000, 100000, 1000000 };
+	for (long n: sizes) {
+	    std::vector<int> v(n, 0);
+	    const int repeats = (n <= 10000) ? 100 : (n <= 100000) ? 20 : 5;
+
+	    Clock::time_point t0 = Clock::now();
+	    for (int r = 0; r != repeats; ++r)
+		threadpool::parallel::for_each<thread_count>(v, [](int& e){ ++e; });
+	    Clock::time_point t1 = Clock::now();
+
+	    report("for_each_scaling", "increment_int", thread_count, n,
+		   "us_per_call", microseconds_between(t0, t1) / repeats, "us");
+	}
+    }
+
+
+
+    /**
+     * A deliberately expensive per-element function: an integer
+     * recurrence the optimizer can not collapse.
+     */
+    unsigned int expensive_work(unsigned int x)
+    {
+	unsigned int k = x;
+	for (int i = 0; i != 2000; ++i)
+	    k = k * 1664525u + 1013904223u;
+	return k;
+    }
+
+    /**
+     * parallel::transform() with a cheap and with an expensive
+     * per-element function, default thread count against the
+     * singlethreaded algorithm.
+     */
+    template<int thread_count>
+    void bench_transform()
+    {
+	{ // Cheap function: throughput is dominated by the queue
+	    const long n = 100000;
+	    const int repeats = 20;
+	    std::vector<unsigned int> in(n), out(n);
+	    for (long i = 0; i != n; ++i)
+		in[i] = static_cast<unsigned int>(i);
+
+	    Clock::time_point t0 = Clock::now();
+	    for (int r = 0; r != repeats; ++r)
+		threadpool::parallel::transform<thread_count
+						>(in.begin(), in.end(), out.begin(),
+						  [](unsigned int x) { return 2 * x; });
+	    Clock::time_point t1 = Clock::now();
+
+	    report("transform", "cheap", thread_count, n, "us_per_call",
+		   microseconds_between(t0, t1) / repeats, "us");
+	}
+	{ // Expensive function: throughput is dominated by the work
+	    const long n = 20000;
+	    const int repeats = 5;
+	    std::vector<unsigned int> in(n), out(n);
+	    for (long i = 0; i != n; ++i)
+		in[i] = static_cast<unsigned int>(i);
+
+	    Clock::time_point t0 = Clock::now();
+	    for (int r = 0; r != repeats; ++r)
+		threadpool::parallel::transform<thread_count
+						>(in.begin(), in.end(), out.begin(),
+						  expensive_work);
+	    Clock::time_point t1 = Clock::now();
+
+	    report("transform", "expensive", thread_count, n, "us_per_call",
+		   microseconds_between(t0, t1) / repeats, "us");
+	}
+    }
+
+} // End of anonymous namespace
+
+
+
+int main()
+{
+    std::cout << "benchmark,variant,threads,elements,metric,value,unit\n";
+    report("machine", "-", -1, 0, "hardware_concurrency",
+	   std::thread::hardware_concurrency(), "threads");
+
+    bench_queue_throughput();
+    bench_run_latency();
+
+    bench_for_each_scaling<1>();
+    bench_for_each_scaling<2>();
+    bench_for_each_scaling<4>();
+    bench_for_each_scaling<8>();
+    bench_for_each_scaling<-1>();
+
+    bench_transform<1>();
+    bench_transform<-1>();
+
+    return 0;
+}
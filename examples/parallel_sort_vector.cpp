@@ -0,0 +1,31 @@
+/// @file examples/parallel_sort_vector.cpp
+/** @example parallel_sort_vector.cpp
+    Using parallel::sort() on entire containers */
+#include <cassert>
+#include <algorithm>
+#include <ostream>
+#include <iostream>
+#include <vector>
+// Include header for parallel::sort()
+#include "threadpool/parallel_sort.h"
+
+int main() {
+
+    // Create a scrambled vector of ints
+    std::vector<int> v(100000);
+    for (unsigned int i = 0; i < v.size(); ++i)
+	v[i] = (i * 2654435761u) % 100000;
+
+    // Sort it in ascending order
+    threadpool::parallel::sort(v);
+
+    assert(std::is_sorted(v.begin(), v.end()));
+
+    // Sort it in descending order with a comparison function
+    threadpool::parallel::sort(v, [] (int a, int b) { return b < a; });
+
+    assert(std::is_sorted(v.begin(), v.end(),
+			  [] (int a, int b) { return b < a; }));
+    std::cout << "PASS" << std::endl;
+
+}
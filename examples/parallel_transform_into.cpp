@@ -0,0 +1,31 @@
+/// @file examples/parallel_transform_into.cpp
+/** @example parallel_transform_into.cpp
+    Using parallel::transform_into() to collect results in a
+    container. The container is reserved once and each result is
+    emplace-constructed directly in its final slot. */
+#include <cassert>
+#include <ostream>
+#include <iostream>
+#include <vector>
+// Include header for parallel::transform_into()
+#include "threadpool/parallel_transform.h"
+
+int main() {
+
+    // Create a vector of ints from 1 to 9
+    std::vector<int> v({1,2,3,4,5,6,7,8,9});
+
+    // Multiply each element of the vector with 3, collect the
+    // results in r. No pre-sizing, no back_inserter, no growth
+    // reallocation: r is reserved once and the results are
+    // constructed in place, in input order.
+    std::vector<int> r;
+    threadpool::parallel::transform_into(v, r,
+					 [] (int& e) -> int { return e * 3; });
+
+    assert(r.size() == v.size());
+    for (int i = 0; i < (int)v.size(); ++i)
+	assert(r[i] == 3 * v[i]);
+    std::cout << "PASS" << std::endl;
+
+}
@@ -0,0 +1,295 @@
+/** @file threadpool/executor.h
+ *
+ * Threadpool for C++11, executor and scheduler adapters
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_EXECUTOR_H
+#define THREADPOOL_EXECUTOR_H
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include "threadpool_config.h"
+#include "impl/threadpool_interface_virtual.h"
+
+/*
+  Detect a standard library with P2300 std::execution, so the
+  scheduler shim below can declare itself to the standard sender and
+  scheduler concepts. The shim itself is structural and works
+  without it, with any code that calls the member functions
+  schedule() / connect() / start() directly.
+*/
+#if defined(__has_include)
+#   if __has_include(<version>)
+#	include <version>
+#   endif
+#endif
+#if defined(__cpp_lib_senders) && __cpp_lib_senders >= 202406L
+#   include <execution>
+#   define THREADPOOL_HAS_STD_EXECUTION 1
+#else
+#   define THREADPOOL_HAS_STD_EXECUTION 0
+#endif
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/**
+	 * Lightweight executor handle over a virtual thread pool.
+	 *
+	 * A copyable, equality-comparable value type with an
+	 * execute() member, so executor-consuming code can submit
+	 * work to an existing pool instead of backing a second one.
+	 * The handle does not own the pool; the pool must outlive
+	 * every copy of its executor.
+	 */
+	class PoolExecutor {
+
+	    VirtualThreadPoolInterface* pool;
+
+	public:
+
+	    explicit PoolExecutor(VirtualThreadPoolInterface& pool)
+		: pool(&pool)
+	    { }
+
+	    /**
+	     * Submit a void() callable for execution on the pool.
+	     *
+	     * Like ThreadPool::run(): small closures are stored
+	     * inline in the queue slot, and a submitter finding the
+	     * queue full is conscripted as a helper until space
+	     * opens up.
+	     */
+	    template<class Function>
+	    void execute(Function&& fun) const {
+		pool->run(SmallTask(std::forward<Function>(fun)));
+	    }
+
+	    /**
+	     * Submit a void() callable into a specific priority lane.
+	     */
+	    template<class Function>
+	    void execute(Priority priority, Function&& fun) const {
+		pool->run(priority, SmallTask(std::forward<Function>(fun)));
+	    }
+
+	    /**
+	     * Executors compare equal when they submit to the same
+	     * pool.
+	     */
+	    friend bool operator==(const PoolExecutor& x, const PoolExecutor& y) {
+		return x.pool == y.pool;
+	    }
+
+	    friend bool operator!=(const PoolExecutor& x, const PoolExecutor& y) {
+		return !(x == y);
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Operation state of PoolScheduleSender.
+	 *
+	 * Holds the receiver; start() submits a task referring back
+	 * to this object, so the state must stay at its address
+	 * from start() until the receiver has been completed. It
+	 * is movable only so that connect() can return it in C++11,
+	 * which has no guaranteed copy elision; do not move it
+	 * after start().
+	 */
+	template<class Receiver>
+	class PoolScheduleOperation {
+
+	    VirtualThreadPoolInterface* pool;
+	    Receiver receiver;
+
+	public:
+
+	    PoolScheduleOperation(VirtualThreadPoolInterface* pool,
+				  Receiver receiver)
+		: pool(pool), receiver(std::move(receiver))
+	    { }
+
+	    PoolScheduleOperation(const PoolScheduleOperation&) = delete;
+	    PoolScheduleOperation(PoolScheduleOperation&&) = default;
+	    PoolScheduleOperation& operator=(const PoolScheduleOperation&) = delete;
+	    PoolScheduleOperation& operator=(PoolScheduleOperation&&) = delete;
+
+	    /**
+	     * Start the operation: complete the receiver with
+	     * set_value() on a pool thread. A failure to submit,
+	     * or an exception leaving set_value(), is reported
+	     * through set_error(std::exception_ptr).
+	     */
+	    void start() noexcept {
+		PoolScheduleOperation* self = this;
+		try {
+		    pool->run(SmallTask([self]() {
+				try {
+				    std::move(self->receiver).set_value();
+				} catch (...) {
+				    std::move(self->receiver)
+					.set_error(std::current_exception());
+				}
+			    }));
+		} catch (...) {
+		    std::move(receiver).set_error(std::current_exception());
+		}
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Sender returned by PoolScheduler::schedule().
+	 *
+	 * Completes connected receivers with set_value() on a pool
+	 * thread, or with set_error(std::exception_ptr).
+	 */
+	class PoolScheduleSender {
+
+	    VirtualThreadPoolInterface* pool;
+
+	public:
+
+#if THREADPOOL_HAS_STD_EXECUTION
+	    using sender_concept = std::execution::sender_t;
+	    using completion_signatures = std::execution::completion_signatures<
+		std::execution::set_value_t(),
+		std::execution::set_error_t(std::exception_ptr)>;
+#endif
+
+	    explicit PoolScheduleSender(VirtualThreadPoolInterface& pool)
+		: pool(&pool)
+	    { }
+
+	    template<class Receiver>
+	    PoolScheduleOperation<typename std::decay<Receiver>::type>
+	    connect(Receiver&& receiver) const {
+		return PoolScheduleOperation<typename std::decay<Receiver>::type>(
+		    pool, std::forward<Receiver>(receiver));
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Minimal P2300-style scheduler over a virtual thread pool.
+	 *
+	 * schedule() returns a sender that completes its receiver on
+	 * a pool thread, which is all sender/receiver code needs to
+	 * continue a chain on the pool. The shim does not provide an
+	 * environment or query the completion scheduler; with a
+	 * standard library that ships std::execution it declares
+	 * itself to the standard concepts, everywhere else it is
+	 * plain structural. The pool must outlive the scheduler and
+	 * every operation started through it, and must not be
+	 * join()ed while operations are in flight: a pool shutting
+	 * down discards queued tasks, and a discarded operation
+	 * never completes its receiver.
+	 */
+	class PoolScheduler {
+
+	    VirtualThreadPoolInterface* pool;
+
+	public:
+
+#if THREADPOOL_HAS_STD_EXECUTION
+	    using scheduler_concept = std::execution::scheduler_t;
+#endif
+
+	    explicit PoolScheduler(VirtualThreadPoolInterface& pool)
+		: pool(&pool)
+	    { }
+
+	    PoolScheduleSender schedule() const {
+		return PoolScheduleSender(*pool);
+	    }
+
+	    /**
+	     * Schedulers compare equal when their senders complete
+	     * on the same pool.
+	     */
+	    friend bool operator==(const PoolScheduler& x, const PoolScheduler& y) {
+		return x.pool == y.pool;
+	    }
+
+	    friend bool operator!=(const PoolScheduler& x, const PoolScheduler& y) {
+		return !(x == y);
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+
+
+namespace threadpool {
+
+    typedef ThreadPoolImpl::impl::PoolExecutor Executor;
+    typedef ThreadPoolImpl::impl::PoolScheduler Scheduler;
+
+    /**
+     * Create an executor handle submitting to an existing pool.
+     *
+     * @param pool
+     *		The pool to submit to. Any pool implementing the
+     *		virtual pool interface will do, in particular
+     *		threadpool::ThreadPool. It must outlive every copy
+     *		of the executor.
+     *
+     * @returns
+     *		The executor: a copyable, equality-comparable value
+     *		with execute(f) and execute(priority, f) members.
+     */
+    inline Executor
+    make_executor(ThreadPoolImpl::impl::VirtualThreadPoolInterface& pool) {
+	return Executor(pool);
+    }
+
+    /**
+     * Create a P2300-style scheduler over an existing pool.
+     *
+     * @param pool
+     *		The pool on which the scheduled operations complete.
+     *		It must outlive the scheduler and every operation
+     *		started through it.
+     *
+     * @returns
+     *		The scheduler. Its schedule() member returns a
+     *		sender whose operations complete their receiver with
+     *		set_value() on a pool thread.
+     */
+    inline Scheduler
+    make_scheduler(ThreadPoolImpl::impl::VirtualThreadPoolInterface& pool) {
+	return Scheduler(pool);
+    }
+
+} // End of namespace threadpool
+
+#endif // !defined(THREADPOOL_EXECUTOR_H)
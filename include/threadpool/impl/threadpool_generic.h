@@ -14,6 +14,7 @@
 
 #include "../threadpool_config.h"
 #include "threadpool_interface_generic.h"
+#include "threadpool_impl_util.h"
 
 
 
@@ -73,6 +74,26 @@ namespace ThreadPoolImpl {
 	    GenericThreadPoolTmpl(GenericThreadPoolQueue& queue,
 				  int thread_count = -1);
 
+	    /**
+	     * Create a generic thread pool with worker thread
+	     * options.
+	     *
+	     * @param queue
+	     *			The queue managing the tasks.
+	     *
+	     * @param thread_count
+	     *			The number of threads to use, as
+	     *			above.
+	     *
+	     * @param options
+	     *			Options applied on each worker thread
+	     *			after it starts: CPU pinning and a
+	     *			per-worker start callback.
+	     */
+	    GenericThreadPoolTmpl(GenericThreadPoolQueue& queue,
+				  int thread_count,
+				  ThreadOptions options);
+
 	    /**
 	     * Help with the work.
 	     *
@@ -87,6 +108,17 @@ namespace ThreadPoolImpl {
 	     */
 	    void rethrow_exception() override;
 
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking sets the worker target on the queue; surplus
+	     * workers retire once they have been idle past the
+	     * reclamation timeout. Queues without idle-thread
+	     * reclamation ignore the target and keep their workers.
+	     */
+	    void resize(std::size_t thread_count) override;
+
 	    /**
 	     * Wait for all threads to finish and collect them.
 	     *
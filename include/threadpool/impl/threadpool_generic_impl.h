@@ -13,12 +13,15 @@
 #include <limits>
 #include <type_traits>
 #include <functional>		// For std::bind()
+#include <memory>
+#include <atomic>
 #include <vector>
 #include <thread>
 #include <mutex>
 
 #include "../threadpool_config.h"
 #include "threadpool_interface_generic.h"
+#include "threadpool_impl_util.h"
 
 
 
@@ -69,18 +72,35 @@ namespace ThreadPoolImpl {
 
 	    class Worker {
 		std::thread thread;
+
+		/*
+		  Set by the worker thread itself just before it
+		  returns. Shared with the thread function, because
+		  the Worker object may be moved around in the
+		  workers vector while the thread is still running.
+		*/
+		std::shared_ptr<std::atomic<bool>> finished;
+
 	    public:
+		Worker() : finished(new std::atomic<bool>(false)) { }
 		Worker& operator=(std::thread&& t) { thread = std::move(t); return *this; }
+		const std::shared_ptr<std::atomic<bool>>& finished_flag() const { return finished; }
+		bool has_finished() const { return finished->load(); }
 		void join() { if (thread.joinable()) thread.join(); }
 	    };
 
 
 
+#if !THREADPOOL_NOEXCEPT_TASKS
 	    std::mutex mutex;
 	    std::exception_ptr pending_exception;
+#endif
 	    Queue& queue;
+	    const ThreadOptions options;
 
-	    const unsigned int thread_count; /// The number of threads
+	    unsigned int thread_count;	/// The number of threads last requested
+
+	    unsigned int next_worker_index; /// Start index for the next spawned worker
 
 	    std::vector<Worker> workers;
 
@@ -93,6 +113,78 @@ namespace ThreadPoolImpl {
 		help(false);
 	    }
 
+	    /**
+	     * The start function of a newly spawned worker: apply
+	     * the thread options, then work.
+	     *
+	     * @param index
+	     *		The index of the worker. Workers spawned later
+	     *		through resize() continue the numbering.
+	     *
+	     * @param finished
+	     *		Flag raised just before the thread returns, so
+	     *		the pool can reap the finished workers.
+	     */
+	    void worker_main(unsigned int index,
+			     std::shared_ptr<std::atomic<bool>> finished) {
+		auto x1 = at_scope_exit([&finished](){ finished->store(true); });
+#if THREADPOOL_NOEXCEPT_TASKS
+		// Exception-free pipeline: a throwing start callback
+		// terminates, like a throwing task would.
+		if (!options.cpus.empty())
+		    pin_current_thread_to_cpus(options.cpus);
+		if (options.at_thread_start)
+		    options.at_thread_start(index);
+#else
+		try {
+		    if (!options.cpus.empty())
+			pin_current_thread_to_cpus(options.cpus);
+		    if (options.at_thread_start)
+			options.at_thread_start(index);
+		} catch (...) {
+		    {
+			std::exception_ptr e = std::current_exception();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!pending_exception)
+			    pending_exception = std::move(e);
+		    }
+		    queue.shutdown();
+		    return;
+		}
+#endif
+		work();
+	    }
+
+
+
+	    /**
+	     * Start one worker thread.
+	     */
+	    void spawn(Worker& w) {
+		w = std::move(std::thread(std::bind(&GenericThreadPoolImpl::worker_main,
+						    this, next_worker_index++,
+						    w.finished_flag())));
+	    }
+
+
+
+	    /**
+	     * Join and discard the workers whose threads have already
+	     * returned, reclaiming their stacks. Workers retired by
+	     * the idle-thread reclamation stay in the vector, with
+	     * the thread terminated, until the next resize() or
+	     * join_workers() collects them.
+	     */
+	    void reap_finished_workers() {
+		for (auto it = workers.begin(); it != workers.end(); )
+		    if (it->has_finished()) {
+			it->join();
+			it = workers.erase(it);
+		    } else {
+			++it;
+		    }
+	    }
+
 
 
 	    /**
@@ -133,14 +225,53 @@ namespace ThreadPoolImpl {
 	     *			std::thread::hardware_concurrency(),
 	     *			as read through hardware_concurrency().
 	     *
+	     * @param options
+	     *			Options applied on each worker thread
+	     *			after it starts: CPU pinning and a
+	     *			per-worker start callback. The
+	     *			default leaves the workers unpinned.
 	     */
-	    GenericThreadPoolImpl(Queue& queue, int thread_count)
-		: pending_exception(nullptr),
+	    GenericThreadPoolImpl(Queue& queue, int thread_count,
+				  ThreadOptions options = ThreadOptions())
+		:
+#if !THREADPOOL_NOEXCEPT_TASKS
+		pending_exception(nullptr),
+#endif
 		queue(queue),
+		options(std::move(options)),
 		thread_count(determine_thread_count(thread_count)),
+		next_worker_index(0),
 		workers(this->thread_count) {
 		for (Worker& w: workers)
-		    w = std::move(std::thread(std::bind(&GenericThreadPoolImpl::work, this)));
+		    spawn(w);
+	    }
+
+
+
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking sets the worker target on the queue; surplus
+	     * workers retire once they have been idle past the
+	     * reclamation timeout, and their stacks are reclaimed by
+	     * the next resize() or join(). Queues without idle-thread
+	     * reclamation ignore the target and keep their workers.
+	     *
+	     * Like construction and join(), this is meant to be
+	     * called from the thread owning the pool; it is not
+	     * synchronized against concurrent resize() or join()
+	     * calls. The counts are approximate while workers are
+	     * still retiring; calling resize() again converges.
+	     */
+	    void resize(std::size_t thread_count) override {
+		reap_finished_workers();
+		while (workers.size() < thread_count) {
+		    workers.emplace_back();
+		    spawn(workers.back());
+		}
+		queue.set_worker_target(static_cast<unsigned int>(thread_count));
+		this->thread_count = static_cast<unsigned int>(thread_count);
 	    }
 
 
@@ -152,6 +283,9 @@ namespace ThreadPoolImpl {
 	     *		Never wait for work, return instead.
 	     */
 	    void help(bool return_if_idle) override {
+#if THREADPOOL_NOEXCEPT_TASKS
+		queue.work(return_if_idle); // No EH frame on the hot path
+#else
 		if (ignore_thread_pool_exceptions()) {
 		    queue.work(return_if_idle);
 		} else {
@@ -167,6 +301,7 @@ namespace ThreadPoolImpl {
 			queue.shutdown();
 		    }
 		}
+#endif
 	    }
 
 
@@ -176,6 +311,9 @@ namespace ThreadPoolImpl {
 	     * thread.
 	     */
 	    void rethrow_exception() override {
+#if THREADPOOL_NOEXCEPT_TASKS
+		; // Nothing can be pending
+#else
 		if (pending_exception && !std::uncaught_exception()) {
 		    queue.shutdown();
 		    join_workers();
@@ -185,6 +323,7 @@ namespace ThreadPoolImpl {
 			std::rethrow_exception(std::move(e));
 		    }
 		}
+#endif
 	    }
 
 
@@ -24,6 +24,14 @@ namespace ThreadPoolImpl {
 	    : pimpl(new GenericThreadPoolImpl<GenericThreadPoolQueue>(queue, thread_count))
 	{ }
 
+	template<int I>
+	GenericThreadPoolTmpl<I>::GenericThreadPoolTmpl(GenericThreadPoolQueue& queue,
+							int thread_count,
+							ThreadOptions options)
+	    : pimpl(new GenericThreadPoolImpl<GenericThreadPoolQueue>(queue, thread_count,
+								      std::move(options)))
+	{ }
+
 	template<int I>
 	void GenericThreadPoolTmpl<I>::help(bool return_if_idle) {
 	    pimpl->help(return_if_idle);
@@ -34,6 +42,11 @@ namespace ThreadPoolImpl {
 	    pimpl->rethrow_exception();
 	}
 
+	template<int I>
+	void GenericThreadPoolTmpl<I>::resize(std::size_t thread_count) {
+	    pimpl->resize(thread_count);
+	}
+
 	template<int I>
 	void GenericThreadPoolTmpl<I>::join() {
 	    pimpl->join();
@@ -44,37 +44,21 @@ namespace ThreadPoolImpl {
 	template<int = 0>
 	class VirtualThreadPoolImpl : public VirtualThreadPoolInterface {
 
-	    /**
-	     * Store pointers into the queue. Decorate the pointers
-	     * with an operator() to make them callable as needed by
-	     * HomogenousThreadPool.
-	     *
-	     * I tried std::unique_ptr but at least with g++ it was
-	     * very slow. Seems to do some heavyweight locking. Using
-	     * raw pointers, we can just delete them in the tasks
-	     * operator() or in the destructor. This is even more
-	     * flexible than using std::unique_ptr, there may be use
-	     * cases where the task shall outlive the execution by the
-	     * thread pool, for example for cleanup work to be done.
-	     *
-	     * Delete copy-constructor and copy-assignment so `pimpl`
-	     * is not deleted twice. The move constructor makes sure
-	     * to leave an empty `pimpl` behind.
-	     */
-	    class QueueElement {
-		VirtualThreadPool_Task* pimpl;
-		QueueElement() = delete;
-		QueueElement(const QueueElement&) = delete;
-		QueueElement& operator=(const QueueElement&) = delete;
-		QueueElement& operator=(QueueElement&&) = delete;
-	    public:
-		QueueElement(VirtualThreadPool_Task* t)	: pimpl(t) { }
-		QueueElement(QueueElement&& x) : pimpl(x.pimpl) { x.pimpl = nullptr; }
-		void operator()() { (*pimpl)(); pimpl = nullptr; }
-		~QueueElement() { if (pimpl) delete pimpl; }
-	    };
-
-	    HomogenousThreadPool<QueueElement> impl;
+	    /*
+	      The queue elements are SmallTask objects. Small
+	      callables are stored inline in the queue slot, so the
+	      common run(lambda) path allocates nothing; larger ones
+	      and tasks submitted through the VirtualThreadPool_Task
+	      interface are carried as raw pointers and deleted in
+	      the tasks operator() or in the SmallTask destructor.
+
+	      (An earlier version stored raw VirtualThreadPool_Task
+	      pointers here; I tried std::unique_ptr but at least
+	      with g++ it was very slow. Seems to do some heavyweight
+	      locking.)
+	    */
+
+	    HomogenousThreadPool<SmallTask> impl;
 
 	public:
 
@@ -82,15 +66,48 @@ namespace ThreadPoolImpl {
 
 	    explicit VirtualThreadPoolImpl(int thread_count = -1,
 					   std::size_t queue_size = 0,
-					   std::size_t maxpart = 1)
-		: impl(thread_count, queue_size, maxpart) { }
+					   std::size_t maxpart = 1,
+					   ThreadOptions thread_options = ThreadOptions())
+		: impl(thread_count, queue_size, maxpart, std::move(thread_options)) { }
 
 	    void run(std::unique_ptr<VirtualThreadPool_Task>&& t) {
-		impl.run(t.release());
+		impl.run(SmallTask(std::move(t)));
 	    }
 
 	    void run(VirtualThreadPool_Task* t) {
-		impl.run(t);
+		impl.run(SmallTask(t));
+	    }
+
+	    void run(SmallTask&& t) {
+		impl.run(std::move(t));
+	    }
+
+	    void run(Priority priority, SmallTask&& t) {
+		impl.run(priority, std::move(t));
+	    }
+
+	    bool try_run(SmallTask&& t) {
+		return impl.try_run(std::move(t));
+	    }
+
+	    void notify_when_space(std::function<void()> callback) {
+		impl.notify_when_space(std::move(callback));
+	    }
+
+	    void run_batch(std::vector<SmallTask>&& batch) {
+		impl.run_batch(batch.begin(), batch.end());
+	    }
+
+	    ThreadPoolStatistics statistics() {
+		return impl.statistics();
+	    }
+
+	    std::size_t pending() {
+		return impl.pending();
+	    }
+
+	    void resize(std::size_t thread_count) {
+		impl.resize(thread_count);
 	    }
 
 	    void wait() { impl.wait(); }
@@ -0,0 +1,211 @@
+/** @file threadpool/impl/threadpool_impl_arena.h
+ *
+ * Threadpool for C++11, recycling arena for task objects
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_ARENA_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_ARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  Heap-allocated tasks are created on one thread and freed
+	  with `delete this` on whatever worker ran them. At high
+	  task rates this produces exactly the cross-thread
+	  malloc/free pattern that makes general-purpose allocators
+	  contend on their arenas. Since task blocks come in very few
+	  sizes and have task lifetime, recycle them instead: a small
+	  set of size classes, a thread-local cache in front, and a
+	  mutex-protected central freelist that only sees batch
+	  transfers.
+
+	  The arena is process-wide rather than per-pool because
+	  tasks delete themselves without a reference to their pool;
+	  with the thread-local caches in front the central lock is
+	  uncontended anyway.
+	*/
+
+	/**
+	 * Recycling allocator for task blocks.
+	 *
+	 * Blocks of up to 512 bytes are served from per-thread
+	 * freelists in four size classes (64, 128, 256, 512 bytes)
+	 * and recycled; larger blocks go straight to operator new /
+	 * delete. Thread caches spill to and refill from a central
+	 * freelist in batches, so the central mutex is taken once
+	 * per `transfer_batch` operations at most.
+	 */
+	class TaskArena {
+
+	    static const unsigned int num_classes = 4;
+	    static const std::size_t header_size = 16; // Keeps payload alignment
+	    static const unsigned int cache_max = 64;	// Blocks kept per thread and class
+	    static const unsigned int transfer_batch = 32;
+
+	    struct Block { Block* next; };
+
+	    struct Header { unsigned int cls; };
+
+	    static std::size_t class_size(unsigned int c) {
+		return static_cast<std::size_t>(64) << c;
+	    }
+
+	    static int size_class(std::size_t size) {
+		for (unsigned int c = 0; c != num_classes; ++c)
+		    if (size <= class_size(c))
+			return c;
+		return -1;
+	    }
+
+	    struct Central {
+		std::mutex mutex;
+		Block* head[num_classes];
+		Central() {
+		    for (unsigned int c = 0; c != num_classes; ++c)
+			head[c] = nullptr;
+		}
+		~Central() {
+		    for (unsigned int c = 0; c != num_classes; ++c)
+			while (Block* b = head[c]) {
+			    head[c] = b->next;
+			    ::operator delete(b);
+			}
+		}
+	    };
+
+	    static Central& central() {
+		static Central c;
+		return c;
+	    }
+
+	    struct Cache {
+		Block* head[num_classes];
+		unsigned int count[num_classes];
+		Cache() {
+		    for (unsigned int c = 0; c != num_classes; ++c) {
+			head[c] = nullptr;
+			count[c] = 0;
+		    }
+		}
+		~Cache() { // Thread exits, give the blocks back
+		    Central& ctr = central();
+		    std::lock_guard<std::mutex> lock(ctr.mutex);
+		    for (unsigned int c = 0; c != num_classes; ++c)
+			while (Block* b = head[c]) {
+			    head[c] = b->next;
+			    b->next = ctr.head[c];
+			    ctr.head[c] = b;
+			}
+		}
+	    };
+
+	    static Cache& cache() {
+		static thread_local Cache c;
+		return c;
+	    }
+
+	    /**
+	     * Move up to `transfer_batch` blocks from the central
+	     * freelist into the thread cache.
+	     */
+	    static void refill(Cache& t, unsigned int c) {
+		Central& ctr = central();
+		std::lock_guard<std::mutex> lock(ctr.mutex);
+		for (unsigned int i = 0; i != transfer_batch && ctr.head[c]; ++i) {
+		    Block* b = ctr.head[c];
+		    ctr.head[c] = b->next;
+		    b->next = t.head[c];
+		    t.head[c] = b;
+		    ++t.count[c];
+		}
+	    }
+
+	    /**
+	     * Move `transfer_batch` blocks from the thread cache to
+	     * the central freelist.
+	     */
+	    static void spill(Cache& t, unsigned int c) {
+		Block* chain = nullptr;
+		for (unsigned int i = 0; i != transfer_batch; ++i) {
+		    Block* b = t.head[c];
+		    t.head[c] = b->next;
+		    b->next = chain;
+		    chain = b;
+		    --t.count[c];
+		}
+		Central& ctr = central();
+		std::lock_guard<std::mutex> lock(ctr.mutex);
+		while (chain) {
+		    Block* b = chain;
+		    chain = b->next;
+		    b->next = ctr.head[c];
+		    ctr.head[c] = b;
+		}
+	    }
+
+	public:
+
+	    static void* allocate(std::size_t size) {
+		int c = size_class(size);
+		char* raw;
+		if (c < 0) {
+		    raw = static_cast<char*>(::operator new(header_size + size));
+		    reinterpret_cast<Header*>(raw)->cls = num_classes; // Oversize marker
+		    return raw + header_size;
+		}
+		Cache& t = cache();
+		if (!t.head[c])
+		    refill(t, c);
+		if (t.head[c]) {
+		    Block* b = t.head[c];
+		    t.head[c] = b->next;
+		    --t.count[c];
+		    raw = reinterpret_cast<char*>(b);
+		} else {
+		    raw = static_cast<char*>(::operator new(header_size + class_size(c)));
+		}
+		reinterpret_cast<Header*>(raw)->cls = c;
+		return raw + header_size;
+	    }
+
+	    static void deallocate(void* p) {
+		if (!p)
+		    return;
+		char* raw = static_cast<char*>(p) - header_size;
+		unsigned int c = reinterpret_cast<Header*>(raw)->cls;
+		if (c >= num_classes) {
+		    ::operator delete(raw);
+		    return;
+		}
+		Cache& t = cache();
+		Block* b = reinterpret_cast<Block*>(raw);
+		b->next = t.head[c];
+		t.head[c] = b;
+		if (++t.count[c] > cache_max)
+		    spill(t, c);
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_ARENA_H)
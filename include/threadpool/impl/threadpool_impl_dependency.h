@@ -0,0 +1,175 @@
+/** @file threadpool/impl/threadpool_impl_dependency.h
+ *
+ * Threadpool for C++11, dependency-counted task scheduling
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_DEPENDENCY_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_DEPENDENCY_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "../threadpool_config.h"
+#include "threadpool_interface_virtual.h"
+#include "threadpool_impl_util.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/**
+	 * A successor task gated on a dependency counter.
+	 *
+	 * The pool-wide wait() is a full barrier: in a multi-phase
+	 * computation every task of one phase waits for every task
+	 * of the previous one, even when only some of them are
+	 * related. A Dependency encodes the actual edge: the
+	 * successor task is enqueued on the pool the moment the last
+	 * of its declared predecessors has finished, with no thread
+	 * blocking anywhere. Diamond-shaped graphs chain Dependency
+	 * objects instead of pool-wide barriers.
+	 *
+	 * The number of predecessors is declared up front; each one
+	 * counts down exactly once, whether it ran, threw, or was
+	 * discarded at shutdown, so the successor cannot be lost in
+	 * the queue's bookkeeping. An exception in a predecessor
+	 * propagates like in a plain run() task; the successor still
+	 * becomes runnable, but a pool already shutting down
+	 * discards it.
+	 *
+	 * A Dependency is as cheap as one shared allocation and can
+	 * be copied freely; copies count down the same counter. The
+	 * pool is kept by reference and must outlive the graph.
+	 */
+	class Dependency {
+
+	    struct State {
+		VirtualThreadPoolInterface& pool;
+		std::atomic<std::size_t> remaining;
+		SmallTask successor;
+		State(VirtualThreadPoolInterface& pool, std::size_t n,
+		      SmallTask&& successor)
+		    : pool(pool), remaining(n),
+		      successor(std::move(successor)) { }
+	    };
+
+	    std::shared_ptr<State> state;
+
+	    /**
+	     * One predecessor is done. The release/acquire pair on
+	     * the counter makes all predecessor writes visible to
+	     * the successor before it is enqueued.
+	     */
+	    static void satisfy(const std::shared_ptr<State>& s) {
+		if (s->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		    s->pool.run(std::move(s->successor));
+	    }
+
+	    /**
+	     * Task wrapper counting the dependency down exactly
+	     * once, whether the payload ran, threw, or was
+	     * discarded at shutdown without running.
+	     */
+	    template<class Function>
+	    class PredecessorTask {
+
+		Function f;
+		std::shared_ptr<State> state;
+
+	    public:
+
+		PredecessorTask(Function&& f, std::shared_ptr<State> s)
+		    : f(std::move(f)), state(std::move(s)) { }
+		PredecessorTask(Function& f, std::shared_ptr<State> s)
+		    : f(f), state(std::move(s)) { }
+		PredecessorTask(PredecessorTask&& x)
+		    : f(std::move(x.f)), state(std::move(x.state)) { }
+
+		void operator()() {
+		    std::shared_ptr<State> s = std::move(state);
+		    auto x1 = at_scope_exit([&s](){ Dependency::satisfy(s); });
+		    f();
+		}
+
+		~PredecessorTask() { // Task was discarded without running
+		    if (state)
+			satisfy(state);
+		}
+	    };
+
+	public:
+
+	    /**
+	     * Declare a successor task runnable after `predecessors`
+	     * completions.
+	     *
+	     * @param pool
+	     *		The pool the successor is enqueued on.
+	     *
+	     * @param predecessors
+	     *		How many predecessor completions gate the
+	     *		successor. 0 enqueues it immediately.
+	     *
+	     * @param f
+	     *		The successor, a void function.
+	     */
+	    template<class Function>
+	    Dependency(VirtualThreadPoolInterface& pool,
+		       std::size_t predecessors, Function&& f)
+		: state(new State(pool, predecessors,
+				  SmallTask(std::forward<Function>(f)))) {
+		if (predecessors == 0)
+		    pool.run(std::move(state->successor));
+	    }
+
+	    /**
+	     * Run a void function as a predecessor of this
+	     * dependency: the counter is counted down when it
+	     * completes.
+	     */
+	    template<class Function>
+	    void run(Function&& f) {
+		run(Priority::normal, std::forward<Function>(f));
+	    }
+
+	    /**
+	     * Run a predecessor in a specific priority lane.
+	     */
+	    template<class Function>
+	    void run(Priority priority, Function&& f) {
+		typedef typename std::remove_reference<Function>::type function_type;
+		state->pool.run(priority,
+				SmallTask(PredecessorTask<function_type>(
+					      std::forward<Function>(f), state)));
+	    }
+
+	    /**
+	     * Count one predecessor down by hand, for work that does
+	     * not run through run() — a task on another pool, an
+	     * I/O completion, a then() continuation. Each manual
+	     * predecessor must satisfy() exactly once.
+	     */
+	    void satisfy() {
+		satisfy(state);
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_DEPENDENCY_H)
@@ -0,0 +1,138 @@
+/** @file threadpool/impl/threadpool_impl_drive.h
+ *
+ * Threadpool for C++11, type-erased driver for the parallel algorithms
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_H
+
+#include <cstddef>
+#include <functional>
+
+#include "../threadpool_config.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  The library configuration only moves the pool core behind
+	  the compiler firewall; the algorithm queue templates of
+	  parallel::for_each() and parallel::transform() are still
+	  instantiated in every translation unit that calls them,
+	  once per iterator and function type. For random access
+	  iterators all of them do the same thing: hand out index
+	  chunks [lo, hi) of a counted range under guided
+	  self-scheduling and call a kernel per chunk. The driver
+	  below implements that loop once, against a type-erased
+	  chunk function; the template front ends shrink to a thin
+	  lambda adapting indices to their iterators, and the queue
+	  and pool machinery compiles once into the library. The
+	  type erasure costs one indirect call per chunk, not per
+	  element, which is noise against the chunk's work.
+	*/
+
+	/**
+	 * Type-erased driver running a counted range on the pool.
+	 *
+	 * The template parameter is ignored; the class is a template
+	 * for the same reason as GenericThreadPoolTmpl, so that the
+	 * header-only and the precompiled-library configuration can
+	 * coexist without violating the ODR.
+	 */
+	template<int = 0>
+	class ParallelDriveTmpl {
+
+	public:
+
+	    /**
+	     * The type-erased chunk kernel, called with half-open
+	     * index ranges [lo, hi) of the counted range.
+	     */
+	    typedef std::function<void(std::size_t, std::size_t)> ChunkFunction;
+
+	    /**
+	     * Run a chunk kernel over the index range [0, count).
+	     *
+	     * The chunks are handed out with the guided
+	     * self-scheduling of the algorithm queues: no chunk is
+	     * larger than the remaining input divided by maxpart,
+	     * and none smaller than min_chunk. The kernel is called
+	     * concurrently from multiple threads, with disjoint
+	     * ranges covering [0, count) exactly once.
+	     *
+	     * @param count
+	     *		The number of elements in the range.
+	     *
+	     * @param thread_count
+	     *		The number of threads. -1 borrows the
+	     *		workers of the process-wide shared pool;
+	     *		other values spawn a dedicated pool. The
+	     *		single-threaded case is the caller's
+	     *		business, as in the algorithm front ends.
+	     *
+	     * @param maxpart
+	     *		The maximum part of the remaining input
+	     *		range that one chunk may take, already
+	     *		resolved by the caller; 0 for single-index
+	     *		chunks.
+	     *
+	     * @param min_chunk
+	     *		The minimum chunk size, at least 1.
+	     *
+	     * @param chunk
+	     *		The chunk kernel.
+	     */
+	    static void drive_blocked(std::size_t count,
+				      int thread_count,
+				      std::size_t maxpart,
+				      std::size_t min_chunk,
+				      const ChunkFunction& chunk);
+
+	};
+
+
+
+
+
+	typedef ParallelDriveTmpl<> ParallelDrive;
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+
+
+/*
+  For library configuration hide internals behind compiler firewall.
+  For header-only configuration reveal internals.
+ */
+#if defined(THREADPOOL_USE_LIBRARY) && THREADPOOL_USE_LIBRARY
+
+     namespace ThreadPoolImpl {
+	 namespace impl {
+	     extern template class ParallelDriveTmpl<>;
+	 }
+     }
+
+#else // !THREADPOOL_USE_LIBRARY
+
+#   include "threadpool_impl_drive_inst.h"
+
+#endif // !THREADPOOL_USE_LIBRARY
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_H)
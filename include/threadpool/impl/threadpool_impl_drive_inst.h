@@ -0,0 +1,129 @@
+/** @file threadpool/impl/threadpool_impl_drive_inst.h
+ *
+ * Threadpool for C++11, library version of the type-erased driver
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_INST_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_INST_H
+
+#include <cstddef>
+#include <mutex>
+
+#include "threadpool_impl_drive.h"
+#include "threadpool_generic.h"
+#include "threadpool_impl_shared.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/**
+	 * Queue handing out index chunks of a counted range.
+	 *
+	 * The index-space twin of ForEachBlockedThreadPoolImpl_Queue,
+	 * with the iterator and function types erased: the same
+	 * guided self-scheduling over [0, count), calling a
+	 * type-erased kernel once per chunk.
+	 */
+	class ParallelDriveTmpl_Queue : public GenericThreadPoolQueue {
+
+	    const ParallelDriveTmpl<>::ChunkFunction& chunk;
+	    std::mutex mutex; // Make sure threads do not access concurrently
+	    const std::size_t maxpart;
+	    const std::size_t min_chunk;
+	    std::size_t current;
+	    const std::size_t last;
+
+	public:
+
+	    ParallelDriveTmpl_Queue(std::size_t count,
+				    std::size_t maxpart,
+				    std::size_t min_chunk,
+				    const ParallelDriveTmpl<>::ChunkFunction& chunk)
+		: chunk(chunk),
+		  maxpart(maxpart),
+		  min_chunk(min_chunk ? min_chunk : 1),
+		  current(0),
+		  last(count)
+	    { }
+
+	    void work(bool /*ignored*/) override
+	    {
+		for (;;) {
+		    std::size_t c, l;
+		    {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if ((c = current) == last)
+			    break;
+
+			std::size_t remaining = last - current;
+			std::size_t stride =
+			    (maxpart == 0) ? 1 : remaining / maxpart;
+			if (stride < min_chunk)
+			    stride = min_chunk;
+			if (stride > remaining)
+			    stride = remaining;
+			if (stride == 0)
+			    stride = 1;
+
+			l = c + stride;
+			current = l;
+		    }
+
+		    chunk(c, l); // One call for the whole chunk
+		}
+	    }
+
+	    /**
+	     * Shut the queue down, stop returning chunks
+	     */
+	    void shutdown() override
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		current = last;
+	    }
+	};
+
+
+
+
+
+	template<int I>
+	void ParallelDriveTmpl<I>::drive_blocked(std::size_t count,
+						 int thread_count,
+						 std::size_t maxpart,
+						 std::size_t min_chunk,
+						 const ChunkFunction& chunk)
+	{
+	    ParallelDriveTmpl_Queue queue(count, maxpart, min_chunk, chunk);
+
+	    if (thread_count == -1) {
+		// Borrow the workers of the shared pool instead of
+		// spawning threads for this one call.
+		run_on_shared_pool(queue,
+				   GenericThreadPool::determine_thread_count(thread_count));
+	    } else {
+		// An explicit thread count requests a dedicated pool.
+		GenericThreadPool pool(queue, thread_count);
+		pool.join();
+	    }
+	}
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_DRIVE_INST_H)
@@ -0,0 +1,423 @@
+/** @file threadpool/impl/threadpool_impl_future.h
+ *
+ * Threadpool for C++11, lightweight future with recycled shared state
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_FUTURE_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_FUTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "threadpool_impl_arena.h"
+#include "threadpool_impl_util.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  std::promise/std::future cost a heap allocation for the
+	  shared state plus reference counting on every task with a
+	  result. For small compute kernels that overhead dwarfs the
+	  task body. This lightweight replacement allocates the
+	  shared state from the recycling TaskArena, publishes the
+	  result with one atomic store, and touches the mutex and
+	  condition variable only when a consumer actually has to
+	  block.
+	*/
+
+	/**
+	 * Shared state between a task and the LightFuture waiting
+	 * for its result.
+	 *
+	 * Reference-counted with two initial owners, the task and
+	 * the future. The block is recycled through TaskArena when
+	 * the second owner releases it.
+	 */
+	template<class T>
+	class LightFutureState {
+
+	    enum { pending, ready, failed };
+
+	    std::atomic<unsigned int> status;
+	    std::atomic<unsigned int> refs;
+	    std::atomic<bool> waiting;
+	    std::mutex mutex;
+	    std::condition_variable ready_cv;
+	    typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+	    std::exception_ptr exception;
+
+	    /*
+	      Optional continuation, fired exactly once when the
+	      result is published: by publish(), or by
+	      set_continuation() itself when the result was already
+	      there. Guarded by `mutex`; the atomic flag keeps
+	      publish() lock-free while no continuation is
+	      registered.
+	    */
+	    std::function<void()> continuation;
+	    std::atomic<bool> has_continuation;
+
+	    LightFutureState()
+		: status(pending), refs(2), waiting(false),
+		  has_continuation(false) { }
+
+	    ~LightFutureState() {
+		if (status.load(std::memory_order_relaxed) == ready)
+		    reinterpret_cast<T*>(&value)->~T();
+	    }
+
+	    /**
+	     * Mark the state ready or failed, and wake the consumer
+	     * if one is blocked. The seq_cst orderings on `status`
+	     * and `waiting` pair with the ones in wait_ready() so a
+	     * consumer never sleeps through the wakeup.
+	     */
+	    void publish(unsigned int s) {
+		status.store(s);
+		if (waiting.load()) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    ready_cv.notify_all();
+		}
+		if (has_continuation.load())
+		    fire_continuation();
+	    }
+
+	    /**
+	     * Fire the registered continuation. Moving it out under
+	     * the mutex makes the invocation once-only even when
+	     * publish() and set_continuation() race.
+	     */
+	    void fire_continuation() {
+		std::function<void()> c;
+		{
+		    std::lock_guard<std::mutex> lock(mutex);
+		    c = std::move(continuation);
+		    continuation = nullptr;
+		}
+		if (c)
+		    c();
+	    }
+
+	public:
+
+	    static LightFutureState* create() {
+		return new (TaskArena::allocate(sizeof(LightFutureState)))
+		    LightFutureState();
+	    }
+
+	    void release() {
+		if (refs.fetch_sub(1) == 1) {
+		    this->~LightFutureState();
+		    TaskArena::deallocate(this);
+		}
+	    }
+
+	    template<class U>
+	    void set_value(U&& v) {
+		new (&value) T(std::forward<U>(v));
+		publish(ready);
+	    }
+
+	    void set_exception(std::exception_ptr e) {
+		exception = std::move(e);
+		publish(failed);
+	    }
+
+	    /**
+	     * Abandon the state: publish the same broken_promise
+	     * error an abandoned std::promise would. std::future_error
+	     * is not publicly constructible in C++11, so the
+	     * exception is generated from an actual abandoned
+	     * promise. Cold path, only reached when a task is
+	     * discarded without running.
+	     */
+	    void abandon() {
+		std::future<char> f;
+		{
+		    std::promise<char> p;
+		    f = p.get_future();
+		}
+		try {
+		    f.get();
+		} catch (...) {
+		    set_exception(std::current_exception());
+		}
+	    }
+
+	    bool is_ready() const {
+		return status.load() != pending;
+	    }
+
+	    /**
+	     * Register a continuation to run as soon as the result
+	     * is published. The seq_cst orderings pair with the
+	     * ones in publish(): either publish() sees the armed
+	     * flag, or this function sees the published status, or
+	     * both; fire_continuation() is once-only either way.
+	     */
+	    void set_continuation(std::function<void()> c) {
+		{
+		    std::lock_guard<std::mutex> lock(mutex);
+		    continuation = std::move(c);
+		}
+		has_continuation.store(true);
+		if (status.load() != pending)
+		    fire_continuation();
+	    }
+
+	    /**
+	     * Wait until the producer has published. Spin briefly on
+	     * the status, then block on the condition variable.
+	     */
+	    void wait_ready() {
+		for (int spin = 0; spin != 1024; ++spin)
+		    if (status.load() != pending)
+			return;
+		std::unique_lock<std::mutex> lock(mutex);
+		waiting.store(true);
+		while (status.load() == pending)
+		    ready_cv.wait(lock);
+		waiting.store(false);
+	    }
+
+	    /**
+	     * Move the result out, or rethrow the stored exception.
+	     * Only valid once the state is ready.
+	     */
+	    T take() {
+		if (status.load() == failed)
+		    std::rethrow_exception(exception);
+		return std::move(*reinterpret_cast<T*>(&value));
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Lightweight future for results of pool tasks
+	 *
+	 * Like std::future, but the shared state comes from the
+	 * recycling task arena and the producer signals completion
+	 * with a single atomic store, so a run()/get() round trip
+	 * does not touch the heap or, on the fast path, any lock.
+	 *
+	 * Move-only and single-shot: get() invalidates the future.
+	 * If the task is discarded before it ran (pool join()), get()
+	 * throws std::future_error with code broken_promise, like an
+	 * abandoned std::promise.
+	 */
+	template<class T>
+	class LightFuture {
+
+	    LightFutureState<T>* state;
+
+	    LightFuture(const LightFuture&) = delete;
+	    LightFuture& operator=(const LightFuture&) = delete;
+
+	public:
+
+	    LightFuture() noexcept : state(nullptr) { }
+
+	    explicit LightFuture(LightFutureState<T>* s) noexcept : state(s) { }
+
+	    LightFuture(LightFuture&& x) noexcept : state(x.state) {
+		x.state = nullptr;
+	    }
+
+	    LightFuture& operator=(LightFuture&& x) noexcept {
+		std::swap(state, x.state);
+		return *this;
+	    }
+
+	    /** Does this future refer to a shared state? */
+	    bool valid() const noexcept {
+		return state != nullptr;
+	    }
+
+	    /** Has the result been published yet? */
+	    bool is_ready() const {
+		return state->is_ready();
+	    }
+
+	    /** Block until the result has been published. */
+	    void wait() const {
+		state->wait_ready();
+	    }
+
+	    /**
+	     * Get the result, or rethrow the exception the task
+	     * encountered. Blocks if the task has not finished yet.
+	     * Invalidates the future.
+	     */
+	    T get() {
+		LightFutureState<T>* s = state;
+		state = nullptr;
+		auto x1 = at_scope_exit([s](){ s->release(); });
+		s->wait_ready();
+		return s->take();
+	    }
+
+	    /**
+	     * Schedule a continuation on the result.
+	     *
+	     * The continuation is enqueued on `pool` as soon as the
+	     * result is published (immediately when it already is),
+	     * receives the result by value and does not block
+	     * anybody: phases chain without a pool-wide wait()
+	     * barrier between them. Invalidates this future; for a
+	     * continuation with nonvoid result a new LightFuture is
+	     * returned, so chains compose. If this task failed, the
+	     * continuation is not called and the exception travels
+	     * down the chain to the final get(); a void continuation
+	     * rethrows it on the pool like a plain run() task would.
+	     *
+	     * The pool is captured by reference and must outlive the
+	     * chain; its run() must accept a move-only callable.
+	     */
+	    template<class Pool, class Function>
+	    typename std::enable_if<
+		!std::is_void<typename std::result_of<Function(T)>::type>::value,
+		LightFuture<typename std::result_of<Function(T)>::type> >::type
+	    then(Pool& pool, Function&& fun) {
+
+		typedef typename std::remove_reference<Function>::type function_type;
+		typedef typename std::result_of<Function(T)>::type return_type;
+		typedef LightFutureState<return_type> NewState;
+
+		class ContinuationTask {
+
+		    function_type f;
+		    LightFutureState<T>* from;
+		    NewState* to;
+
+		public:
+
+		    ContinuationTask(const function_type& f,
+				     LightFutureState<T>* from, NewState* to)
+			: f(f), from(from), to(to) { }
+		    ContinuationTask(ContinuationTask&& x)
+			: f(std::move(x.f)), from(x.from), to(x.to) {
+			x.from = nullptr;
+			x.to = nullptr;
+		    }
+
+		    void operator()() {
+			LightFutureState<T>* from = this->from;
+			this->from = nullptr;
+			NewState* to = this->to;
+			this->to = nullptr;
+#if defined(THREADPOOL_NOEXCEPT_TASKS) && THREADPOOL_NOEXCEPT_TASKS
+			to->set_value(f(from->take()));
+#else
+			try {
+			    to->set_value(f(from->take()));
+			} catch (...) {
+			    to->set_exception(std::current_exception());
+			}
+#endif
+			from->release();
+			to->release();
+		    }
+
+		    ~ContinuationTask() { // Task was discarded without running
+			if (to) {
+			    to->abandon();
+			    to->release();
+			}
+			if (from)
+			    from->release();
+		    }
+		};
+
+		LightFutureState<T>* from = state;
+		state = nullptr;
+		NewState* to = NewState::create();
+		LightFuture<return_type> future(to);
+		function_type fn(std::forward<Function>(fun));
+		from->set_continuation([&pool, from, to, fn]() {
+			pool.run(ContinuationTask(fn, from, to));
+		    });
+		return future;
+	    }
+
+	    /**
+	     * Schedule a void continuation on the result; the end of
+	     * a chain. Invalidates this future.
+	     */
+	    template<class Pool, class Function>
+	    typename std::enable_if<
+		std::is_void<typename std::result_of<Function(T)>::type>::value,
+		void>::type
+	    then(Pool& pool, Function&& fun) {
+
+		typedef typename std::remove_reference<Function>::type function_type;
+
+		class ContinuationTask {
+
+		    function_type f;
+		    LightFutureState<T>* from;
+
+		public:
+
+		    ContinuationTask(const function_type& f, LightFutureState<T>* from)
+			: f(f), from(from) { }
+		    ContinuationTask(ContinuationTask&& x)
+			: f(std::move(x.f)), from(x.from) {
+			x.from = nullptr;
+		    }
+
+		    void operator()() {
+			LightFutureState<T>* from = this->from;
+			this->from = nullptr;
+			auto x1 = at_scope_exit([from](){ from->release(); });
+			f(from->take());
+		    }
+
+		    ~ContinuationTask() { // Task was discarded without running
+			if (from)
+			    from->release();
+		    }
+		};
+
+		LightFutureState<T>* from = state;
+		state = nullptr;
+		function_type fn(std::forward<Function>(fun));
+		from->set_continuation([&pool, from, fn]() {
+			pool.run(ContinuationTask(fn, from));
+		    });
+	    }
+
+	    ~LightFuture() {
+		if (state)
+		    state->release();
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_FUTURE_H)
@@ -15,9 +15,14 @@
 #include <cstddef>
 #include <type_traits>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <chrono>
 
+#include "../threadpool_config.h"
 #include "threadpool_generic.h"
 #include "threadpool_impl_util.h"
 
@@ -48,273 +53,957 @@ namespace ThreadPoolImpl {
 
 
 	/**
-	 * Thread pool with homogenous functions
+	 * Queue for functions with signature void()
 	 *
-	 * This thread pool is dependent on template parameter
+	 * This queue is dependent on template parameter
 	 * Function. Only one type of functions can be queued. For
-	 * example if this thread pool is instantiated for a lambda
-	 * function, only this exact lambda function can be run,
-	 * since each lambda function has its own type separate from
-	 * all other lambda functions.
+	 * example if this queue is instantiated for a lambda
+	 * function, only this exact lambda function can be
+	 * queued, since each lambda function has its own type
+	 * separate from all other lambda functions.
 	 *
-	 * To make this thread pool more universally usable,
-	 * instantiate it either with std::function<void()>, or use
-	 * the virtual thread pool VirtualThreadPool.
+	 * To make this queue more flexible, instantiate it either
+	 * with std::function<void()>, or use the virtual thread
+	 * pool VirtualThreadPool.
 	 *
 	 * @tparam Function
-	 *		The function type to be used for the
-	 *		queue. All tasks to be queued must be of this
-	 *		type. The class Function must support the
-	 *		following interface:
-	 *		- operator()(): the functions must be callable
-	 *		  with no parameters.
+	 *		The function type to queue.
 	 */
 	template<class Function>
-	class HomogenousThreadPool {
+	class HQueue : public GenericThreadPoolQueue {
+
+	    /*
+	      If we would use a deque, we would have to protect
+	      against overlapping accesses to the front and the
+	      back. The standard containers do not allow this. Use a
+	      vector instead.  With a vector it is possible to access
+	      both ends of the queue at the same time, as push()ing
+	      and pop()ing does not modify the container itself but
+	      only its elements.
+	    */
+	    class Queue {
+		union Fun {
+#ifdef _MSC_VER // Work around Visual C++ bug, does not like constructable objects in unions
+		    alignas(Function) char fun[sizeof(Function)];
+#else // Standard conforming, C++11 9.5
+		    Function fun; // Only used between pop_ptr and push_ptr
+#endif
+		    Fun() noexcept { }
+		    Fun(const Fun&) noexcept { }
+		    Fun(Fun&&) noexcept { }
+		    ~Fun() noexcept { }
+		};
 
-	    /**
-	     * Queue for functions with signature void()
-	     *
-	     * This queue is dependent on template parameter
-	     * Function. Only one type of functions can be queued. For
-	     * example if this queue is instantiated for a lambda
-	     * function, only this exact lambda function can be
-	     * queued, since each lambda function has its own type
-	     * separate from all other lambda functions.
-	     *
-	     * To make this queue more flexible, instantiate it either
-	     * with std::function<void()>, or use the virtual thread
-	     * pool VirtualThreadPool.
-	     *
-	     * @tparam Function
-	     *		The function type to queue.
-	     */
-	    class HQueue : public GenericThreadPoolQueue {
+		/*
+		  The ring is stored in fixed-size segments, allocated
+		  on demand by the push side as the fill level grows
+		  and given back by shrink() when it falls. Only the
+		  small block pointer array is allocated up front, so
+		  an idle queue costs one segment instead of
+		  queue_size + 1 Fun slots. The block pointers are
+		  atomic because the push side installs a segment
+		  while the pop side may load it; the Fun slots
+		  themselves are synchronized exactly like before, by
+		  the two-mutex protocol of the enclosing HQueue.
+		*/
+		static const std::size_t segment_size = 64;
+
+		std::unique_ptr<std::atomic<Fun*>[]> segment;
+		std::size_t segments;
+		std::size_t ring_size;
+		std::size_t cap;
 
 		/*
-		  If we would use a deque, we would have to protect
-		  against overlapping accesses to the front and the
-		  back. The standard containers do not allow this. Use a
-		  vector instead.  With a vector it is possible to access
-		  both ends of the queue at the same time, as push()ing
-		  and pop()ing does not modify the container itself but
-		  only its elements.
+		  Keep the two ring ends, and the ends of a
+		  neighboring lane, a full interference range
+		  apart. Padding bytes instead of alignas(), because
+		  the C++11 operator new does not honor extended
+		  alignment for heap-allocated pools.
 		*/
-		class Queue {
-		    union Fun {
-#ifdef _MSC_VER // Work around Visual C++ bug, does not like constructable objects in unions
-			alignas(Function) char fun[sizeof(Function)];
-#else // Standard conforming, C++11 9.5
-			Function fun; // Only used between pop_ptr and push_ptr
-#endif
-			Fun() noexcept { }
-			Fun(const Fun&) noexcept { }
-			Fun(Fun&&) noexcept { }
-			~Fun() noexcept { }
-		    };
-		    std::vector<Fun> impl;
-		    std::size_t push_ptr = 0, pop_ptr = 0;
-
-		    Queue(const Queue&) = delete;
-		    Queue(Queue&&) = delete;
-		    Queue& operator=(const Queue&) = delete;
-		    Queue& operator=(Queue&&) = delete;
-
-		public:
-
-		    Queue(std::size_t s) : impl(s + 1) { }
-
-		    template<class F> void push(F&& f) {
-			new (&impl[push_ptr].fun) Function(std::forward<F>(f));
-			if (++push_ptr == impl.size()) push_ptr = 0;
+		char pad0[cache_line_size];
+		std::size_t push_ptr = 0;
+		char pad1[cache_line_size];
+		std::size_t pop_ptr = 0;
+		char pad2[cache_line_size];
+
+		Queue(const Queue&) = delete;
+		Queue(Queue&&) = delete;
+		Queue& operator=(const Queue&) = delete;
+		Queue& operator=(Queue&&) = delete;
+
+		void init(std::size_t s) {
+		    cap = s;
+		    segments = s / segment_size + 1; // ring_size >= s + 1
+		    ring_size = segments * segment_size;
+		    segment.reset(new std::atomic<Fun*>[segments]);
+		    for (std::size_t i = 0; i != segments; ++i)
+			segment[i].store(nullptr, std::memory_order_relaxed);
+		    segment[0].store(new Fun[segment_size],
+				     std::memory_order_relaxed);
+		}
+
+		void release_segments() {
+		    for (std::size_t i = 0; i != segments; ++i)
+			delete[] segment[i].exchange(nullptr,
+							 std::memory_order_relaxed);
+		}
+
+		Fun& push_slot(std::size_t i) {
+		    std::size_t s = i / segment_size;
+		    Fun* p = segment[s].load(std::memory_order_relaxed);
+		    if (!p) { // Grow by one segment on demand
+			p = new Fun[segment_size];
+			segment[s].store(p, std::memory_order_release);
 		    }
+		    return p[i % segment_size];
+		}
+
+		Fun& pop_slot(std::size_t i) {
+		    return segment[i / segment_size]
+			.load(std::memory_order_acquire)[i % segment_size];
+		}
+
+	    public:
+
+		Queue(std::size_t s) { init(s); }
 
-		    Function pop() {
+		template<class F> void push(F&& f) {
+		    new (&push_slot(push_ptr).fun) Function(std::forward<F>(f));
+		    if (++push_ptr == ring_size) push_ptr = 0;
+		}
+
+		Function pop() {
+		    Fun& slot = pop_slot(pop_ptr);
 #ifdef _MSC_VER // Work around Visual C++ bug, does not like constructable objects in unions
-			Function r = std::move(reinterpret_cast<Function&>(impl[pop_ptr].fun));
-			reinterpret_cast<Function&>(impl[pop_ptr].fun).~Function();
+		    Function r = std::move(reinterpret_cast<Function&>(slot.fun));
+		    reinterpret_cast<Function&>(slot.fun).~Function();
 #else
-			Function r = std::move(impl[pop_ptr].fun);
-			impl[pop_ptr].fun.~Function();
+		    Function r = std::move(slot.fun);
+		    slot.fun.~Function();
 #endif
-			if (++pop_ptr == impl.size()) pop_ptr = 0;
-			return r;
-		    }
+		    if (++pop_ptr == ring_size) pop_ptr = 0;
+		    return r;
+		}
 
-		    std::size_t size() const {
-			std::size_t r = push_ptr + impl.size() - pop_ptr;
-			if (r >= impl.size()) r -= impl.size();
-			return r;
-		    }
+		std::size_t size() const {
+		    std::size_t r = push_ptr + ring_size - pop_ptr;
+		    if (r >= ring_size) r -= ring_size;
+		    return r;
+		}
+
+		bool empty() const {
+		    return push_ptr == pop_ptr;
+		}
 
-		    bool empty() const {
-			return push_ptr == pop_ptr;
+		std::size_t capacity() {
+		    return cap;
+		}
+
+		void reserve(std::size_t s) {
+		    assert(empty()); // Copying / moving of Fun not supported.
+		    if (s > cap) {
+			release_segments();
+			push_ptr = pop_ptr = 0;
+			init(s);
 		    }
+		}
 
-		    std::size_t capacity() {
-			return impl.size() - 1;
+		/**
+		 * Give drained storage segments back to the allocator.
+		 *
+		 * Must be called with BOTH ring ends locked: with the
+		 * two pointers frozen, every segment not overlapping
+		 * [pop_ptr, push_ptr] is unreachable and can be
+		 * freed. The segment the push pointer is in is always
+		 * kept, so an idle queue ends up with one segment,
+		 * like a freshly constructed one.
+		 */
+		void shrink() {
+		    std::size_t po = pop_ptr / segment_size;
+		    std::size_t pu = push_ptr / segment_size;
+		    for (std::size_t s = 0; s != segments; ++s) {
+			bool in_use = (po <= pu)
+			    ? (po <= s && s <= pu)
+			    : (s >= po || s <= pu);
+			if (!in_use)
+			    delete[] segment[s].exchange(nullptr,
+							 std::memory_order_relaxed);
 		    }
+		}
+
+		~Queue() {
+		    while (!empty()) pop();
+		    release_segments();
+		}
+	    };
+
+
+
+	    /*
+	      This queue requires attention for protection against
+	      concurrent access. Protect against:
+	      - Concurrent access by two worker threads both
+		wanting to get() a task from the queue at the same
+		time.
+	      - Concurrent access by two threads both wanting to
+		put() a task into the queue at the same time.
+	      - A worker thread having determined that the queue
+		is empty, while at the same time a new task is put()
+		into the queue.
+	      - A task wanting to put() a task into the queue
+		having found the queue full, while at the same time
+		the queues fill level decreases.
+	    */
+
+	    /*
+	      The members are grouped by their writer and the groups
+	      padded to the destructive interference size, so producers
+	      touching the push side do not invalidate the lines
+	      consumers need for the pop side, and the rarely written
+	      control state does not ride on either hot line.
+	    */
+
+	    // Read-mostly configuration, shared by everybody
+	    const std::size_t queue_size;
+	    const std::size_t maxpart;
+	    const std::size_t min_chunk;
+
+	    /*
+	      Adaptive wakeup policy: an idle worker first spins
+	      `spin_count` pause iterations, then sleeps once for a
+	      bounded time, then parks on the condition variable.
+	      `spinning_workers` lets put() skip the notification when
+	      a spinner is guaranteed to pick the task up.
+	    */
+	    const std::size_t spin_count;
+
+	    /*
+	      How long a surplus worker must have been idle before it
+	      retires; see set_worker_target().
+	    */
+	    const std::size_t idle_timeout_ms;
+
+	    // Rarely written control state
+	    std::atomic<bool> shutting_down;
+
+	    /*
+	      One-shot backpressure callback, armed by
+	      notify_when_space() while the queue is full and fired by
+	      a worker when space opens up again. The atomic flag lets
+	      the workers skip the push lock when nothing is armed.
+	    */
+	    std::function<void()> space_callback;
+	    std::atomic<bool> space_callback_armed;
+
+	    /*
+	      Producer side: the push lock and the parking protocol
+	      state. The worker counters are atomic so the worker
+	      entry/exit bookkeeping and the chained-notification reads
+	      after a pop do not need the push lock; parking itself
+	      still happens under it, so no wakeup can be lost.
+	    */
+	    char pad0[cache_line_size];
+	    std::mutex push_mutex;
+	    std::atomic<bool> wakeup_is_pending;
+	    std::atomic<unsigned int> idle_workers;
+	    std::atomic<unsigned int> total_workers;
+	    std::atomic<unsigned int> spinning_workers;
+	    std::condition_variable waiting_workers;
+	    std::condition_variable waiters;
+
+	    /*
+	      Dynamic worker population: 0 (the default) keeps every
+	      worker until shutdown; a nonzero target set through
+	      set_worker_target() lets workers beyond the target
+	      retire after idling past idle_timeout_ms. The claims
+	      are made under push_mutex; `exiting_workers` counts the
+	      claims whose total_workers decrement is still in
+	      flight, so concurrent claim checks err towards keeping
+	      a worker rather than dropping below the target.
+	    */
+	    std::atomic<unsigned int> worker_target;
+	    unsigned int exiting_workers;
+
+	    /*
+	      Quiescence protocol: `pending_tasks` counts the tasks
+	      put() but not yet finished, whether still queued,
+	      prefetched or executing. The last decrement to zero bumps
+	      `quiescent_generation` and notifies the `waiters` condition
+	      variable, but only when `quiescence_waiters` says somebody
+	      is parked there, so a draining pool pays one broadcast per
+	      quiescence transition instead of one per idle worker. The
+	      counter is written by both sides at task rate and gets its
+	      own cache line.
+	    */
+	    char pad3[cache_line_size];
+	    std::atomic<std::size_t> pending_tasks;
+	    std::atomic<std::size_t> quiescent_generation;
+	    std::atomic<unsigned int> quiescence_waiters;
+
+	    // Consumer side: the pop lock and the lane rotation tick
+	    char pad1[cache_line_size];
+	    std::mutex pop_mutex;
+	    std::size_t pop_tick;
+
+	    /*
+	      One ring per priority lane, drained in priority order.
+	      The two-mutex protocol is unchanged: each ring is only
+	      push()ed under push_mutex and only pop()ed under
+	      pop_mutex, and the fill levels are read with the same
+	      benign imprecision as before. Each ring pads its own two
+	      ends apart.
+	    */
+	    char pad2[cache_line_size];
+	    Queue lanes_high;
+	    Queue lanes_normal;
+	    Queue lanes_low;
+	    Queue* const lane[priority_count];
+
+	    /**
+	     * Every `starvation_interval`th pop is taken from the
+	     * lowest-priority nonempty lane, so background work makes
+	     * progress even under a steady stream of high-priority
+	     * tasks.
+	     */
+	    static const std::size_t starvation_interval = 16;
+
+	    std::size_t queue_depth() const {
+		return lanes_high.size() + lanes_normal.size() + lanes_low.size();
+	    }
+
+	    bool queue_empty() const {
+		return lanes_high.empty() && lanes_normal.empty() && lanes_low.empty();
+	    }
+
+	    /**
+	     * Choose the ring the next pop comes from: normally the
+	     * highest-priority nonempty lane, periodically the lowest
+	     * one (starvation guard). Must only be called under
+	     * pop_mutex, and only when a task is known to be queued.
+	     */
+	    Queue& next_lane() {
+		if (++pop_tick % starvation_interval == 0)
+		    for (unsigned int i = priority_count; i--; )
+			if (!lane[i]->empty())
+			    return *lane[i];
+		for (unsigned int i = 0; i != priority_count; ++i)
+		    if (!lane[i]->empty())
+			return *lane[i];
+		return lanes_normal; // Not reached
+	    }
+
+#if defined(THREADPOOL_ENABLE_STATISTICS) && THREADPOOL_ENABLE_STATISTICS
+
+	    /*
+	      Runtime statistics, written with relaxed atomics so the
+	      hot paths are not serialized on them. See
+	      ThreadPoolStatistics for the meaning of the counters.
+	    */
+	    char stat_pad[cache_line_size];
+	    std::atomic<unsigned long long> stat_tasks_executed;
+	    std::atomic<unsigned long long> stat_wakeups;
+	    std::atomic<unsigned long long> stat_idle_time_us;
+	    std::atomic<std::size_t> stat_max_queue_depth;
+	    std::atomic<unsigned long long> stat_histogram[ThreadPoolStatistics::histogram_buckets];
+
+	    /**
+	     * Record one executed task in the counters and the
+	     * execution time histogram.
+	     */
+	    void stat_record_execution(const std::chrono::steady_clock::duration& d) {
+		unsigned long long us = static_cast<unsigned long long>(
+		    std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+		unsigned int bucket = 0;
+		while (bucket != ThreadPoolStatistics::histogram_buckets - 1
+		       && us >= (1ull << bucket))
+		    ++bucket;
+		stat_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+		stat_tasks_executed.fetch_add(1, std::memory_order_relaxed);
+	    }
 
-		    void reserve(std::size_t s) {
-			assert(empty()); // Copying / moving of Fun not supported.
-			if (s >= impl.size())
-			    impl.resize(s + 1);
+	    /**
+	     * Track the high-water mark of the queue depth. Only called
+	     * under push_mutex, so the read-modify-write does not race
+	     * with other writers.
+	     */
+	    void stat_record_depth(std::size_t depth) {
+		if (depth > stat_max_queue_depth.load(std::memory_order_relaxed))
+		    stat_max_queue_depth.store(depth, std::memory_order_relaxed);
+	    }
+
+	    void stat_record_wakeups(unsigned long long n) {
+		stat_wakeups.fetch_add(n, std::memory_order_relaxed);
+	    }
+
+#else
+
+	    void stat_record_depth(std::size_t) { }
+	    void stat_record_wakeups(unsigned long long) { }
+
+#endif
+
+	    /**
+	     * Account for `n` finished tasks, executed or discarded.
+	     *
+	     * When the pending count drops to zero, the generation word
+	     * is bumped and parked wait()ers are woken. The default
+	     * sequentially consistent operations are load-bearing: the
+	     * decrement must be ordered before the load of
+	     * `quiescence_waiters`, as the waiter registers before it
+	     * re-reads the pending count. Must not be called with
+	     * push_mutex held.
+	     */
+	    void task_finished(std::size_t n) {
+		if (n == 0)
+		    return;
+		if (pending_tasks.fetch_sub(n) == n) {
+		    quiescent_generation.fetch_add(1);
+		    if (quiescence_waiters.load()) {
+			/*
+			  Notify under the lock, so the bump cannot slip
+			  between a waiter's check of the generation and
+			  its wait().
+			*/
+			std::lock_guard<std::mutex> lock(push_mutex);
+			waiters.notify_all();
 		    }
+		}
+	    }
 
-		    ~Queue() { while (!empty()) pop(); }
-		};
+#if defined(THREADPOOL_ENABLE_TRACING) && THREADPOOL_ENABLE_TRACING
 
+	    /*
+	      Forward the task lifecycle events to the hook macros from
+	      threadpool_config.h. The queue address serves as the pool
+	      identity; see the hook documentation there for the
+	      argument contracts.
+	    */
+	    void trace_enqueue(std::size_t depth) {
+		THREADPOOL_TRACE_ENQUEUE(static_cast<const void*>(this), depth);
+	    }
+	    void trace_dequeue(unsigned int worker,
+			       std::size_t count, std::size_t depth) {
+		THREADPOOL_TRACE_DEQUEUE(static_cast<const void*>(this),
+					 worker, count, depth);
+	    }
+	    void trace_complete(unsigned int worker) {
+		THREADPOOL_TRACE_COMPLETE(static_cast<const void*>(this), worker);
+	    }
+	    void trace_idle_begin(unsigned int worker) {
+		THREADPOOL_TRACE_IDLE_BEGIN(static_cast<const void*>(this), worker);
+	    }
+	    void trace_idle_end(unsigned int worker) {
+		THREADPOOL_TRACE_IDLE_END(static_cast<const void*>(this), worker);
+	    }
 
+#else
 
-		/*
-		  This queue requires attention for protection against
-		  concurrent access. Protect against:
-		  - Concurrent access by two worker threads both
-		    wanting to get() a task from the queue at the same
-		    time.
-		  - Concurrent access by two threads both wanting to
-		    put() a task into the queue at the same time.
-		  - A worker thread having determined that the queue
-		    is empty, while at the same time a new task is put()
-		    into the queue.
-		  - A task wanting to put() a task into the queue
-		    having found the queue full, while at the same time
-		    the queues fill level decreases.
-		*/
+	    /*
+	      Tracing disabled: empty inline stubs, so the call sites
+	      need no conditional compilation and the arguments vanish
+	      with the calls.
+	    */
+	    void trace_enqueue(std::size_t) { }
+	    void trace_dequeue(unsigned int, std::size_t, std::size_t) { }
+	    void trace_complete(unsigned int) { }
+	    void trace_idle_begin(unsigned int) { }
+	    void trace_idle_end(unsigned int) { }
 
-		const std::size_t queue_size;
-		const std::size_t maxpart;
-		bool shutting_down;
-		unsigned int idle_workers;
-		unsigned int total_workers;
-		bool wakeup_is_pending;
-		Queue queue;
-		std::mutex pop_mutex;
-		std::mutex push_mutex;
-		std::condition_variable waiting_workers;
-		std::condition_variable waiters;
- 
-		/**
-		 * Get tasks and execute them. Return as soon as the queue
-		 * shrinks to `return_if_idle` tasks.
-		 */
-		void help(std::ptrdiff_t return_if_idle) {
+#endif
 
-		    std::size_t min_queue_size = return_if_idle < 0 ? 0 : return_if_idle;
+	    /**
+	     * Execute the next prefetched task and keep the pending
+	     * count correct when it throws: the thrown-from task and
+	     * the tasks still sitting in the prefetch buffer, which its
+	     * destructor will discard during unwinding, are all
+	     * finished in the sense of the quiescence protocol.
+	     */
+	    void run_one(Queue& functions) {
+#if THREADPOOL_NOEXCEPT_TASKS
+		functions.pop()();
+#else
+		try {
+		    functions.pop()();
+		} catch (...) {
+		    task_finished(functions.size() + 1);
+		    throw;
+		}
+#endif
+		task_finished(1);
+	    }
 
-		    // Increment total worker count, decrement again on scope exit
-		    { std::lock_guard<std::mutex> lock(push_mutex); ++total_workers; }
-		    //std::cerr << " total_workers(" << this->total_workers << ")";
-		    auto x1 = at_scope_exit([this](){
-			    std::lock_guard<std::mutex> lock(push_mutex);
-			    if (--this->total_workers == this->idle_workers)
-				this->waiters.notify_all();;
-			});
+	    /**
+	     * Get tasks and execute them. Return as soon as the queue
+	     * shrinks to `return_if_idle` tasks.
+	     */
+	    void help(std::ptrdiff_t return_if_idle) {
 
-		    Queue functions(1);
+		std::size_t min_queue_size = return_if_idle < 0 ? 0 : return_if_idle;
 
-		    for (;;) {
-			std::unique_lock<std::mutex> lock(pop_mutex);
+		/*
+		  Set when this worker claims a retirement slot below.
+		  The claim is released only after the total_workers
+		  decrement has happened (scope exits run in reverse
+		  order of construction), so concurrent claim checks
+		  never see the population too high and retire one
+		  worker too many.
+		*/
+		bool exit_claimed = false;
+		auto x0 = at_scope_exit([this, &exit_claimed](){
+			if (exit_claimed) {
+			    std::lock_guard<std::mutex> lock(this->push_mutex);
+			    --this->exiting_workers;
+			}
+		    });
+
+		/*
+		  Increment total worker count, decrement again on scope
+		  exit. The previous count doubles as this worker's index
+		  for the tracing hooks.
+		*/
+		const unsigned int worker_index = total_workers.fetch_add(1);
+		auto x1 = at_scope_exit([this](){
+			--this->total_workers;
+		    });
 
-			std::size_t queue_size;
+		Queue functions(1);
 
-			// Try to get the next task(s)
-			while ((queue_size = queue.size()) <= min_queue_size) {
-			    if (static_cast<std::ptrdiff_t>(queue_size) <= return_if_idle)
-				return;
-			    if (queue_size)
-				break;
+		for (;;) {
+		    std::unique_lock<std::mutex> lock(pop_mutex);
 
-			    // The queue is empty, wait for more tasks to be put()
+		    std::size_t queue_size;
 
-			    lock.unlock();
+		    // Try to get the next task(s)
+		    while ((queue_size = queue_depth()) <= min_queue_size) {
+			if (static_cast<std::ptrdiff_t>(queue_size) <= return_if_idle)
+			    return;
+			if (queue_size)
+			    break;
 
-			    {
-				std::unique_lock<std::mutex> lock(push_mutex);
-				while (queue.empty() && !shutting_down) {
+			// The queue is empty, wait for more tasks to be put()
 
-				    if (++idle_workers == total_workers)
-					waiters.notify_all();;
+			lock.unlock();
 
-				    waiting_workers.wait(lock); // Wait for task to be queued
-				    wakeup_is_pending = false;
+			trace_idle_begin(worker_index);
 
-				    --idle_workers;
+			/*
+			  Spin phase: watch the fill level with pause
+			  instructions for a bounded period. While we
+			  are registered as a spinner, put() skips the
+			  condition-variable notification, saving the
+			  futex wake on the latency path. Parking below
+			  happens only after rechecking the queue under
+			  the push lock, so no wakeup can be lost.
+			*/
+			if (spin_count) {
+			    spinning_workers.fetch_add(1);
+			    for (std::size_t spin = spin_count;
+				 spin-- && queue_empty() && !shutting_down; )
+				cpu_relax();
+			    spinning_workers.fetch_sub(1);
+			}
+
+			{
+			    std::unique_lock<std::mutex> lock(push_mutex);
+
+			    // One timed shallow sleep before deep parking
+			    bool shallow = THREADPOOL_SHALLOW_SLEEP_US != 0;
+
+			    std::chrono::steady_clock::time_point idle_since =
+				std::chrono::steady_clock::now();
+
+			    while (queue_empty() && !shutting_down) {
+
+				/*
+				  Idle-thread reclamation: retire when the
+				  population is above the target and this
+				  worker has been idle past the timeout.
+				  Only parked workers get here, put()-side
+				  helpers have returned above. Checked under
+				  push_mutex, so claims are serialized.
+				*/
+				unsigned int target =
+				    worker_target.load(std::memory_order_relaxed);
+				if (target != 0
+				    && total_workers - exiting_workers > target
+				    && std::chrono::steady_clock::now() - idle_since
+				       >= std::chrono::milliseconds(idle_timeout_ms)) {
+				    ++exiting_workers;
+				    exit_claimed = true;
+				    trace_idle_end(worker_index);
+				    return;
 				}
 
-			    }
+				++idle_workers;
+
+#if defined(THREADPOOL_ENABLE_STATISTICS) && THREADPOOL_ENABLE_STATISTICS
+				std::chrono::steady_clock::time_point idle0 =
+				    std::chrono::steady_clock::now();
+				if (shallow)
+				    waiting_workers.wait_for(lock,
+					std::chrono::microseconds(THREADPOOL_SHALLOW_SLEEP_US));
+				else if (worker_target.load(std::memory_order_relaxed))
+				    // Managed population: wake to recheck the claim
+				    waiting_workers.wait_for(lock,
+					std::chrono::milliseconds(idle_timeout_ms));
+				else
+				    waiting_workers.wait(lock); // Wait for task to be queued
+				stat_idle_time_us.fetch_add(
+				    static_cast<unsigned long long>(
+					std::chrono::duration_cast<std::chrono::microseconds>(
+					    std::chrono::steady_clock::now() - idle0).count()),
+				    std::memory_order_relaxed);
+#else
+				if (shallow)
+				    waiting_workers.wait_for(lock,
+					std::chrono::microseconds(THREADPOOL_SHALLOW_SLEEP_US));
+				else if (worker_target.load(std::memory_order_relaxed))
+				    // Managed population: wake to recheck the claim
+				    waiting_workers.wait_for(lock,
+					std::chrono::milliseconds(idle_timeout_ms));
+				else
+				    waiting_workers.wait(lock); // Wait for task to be queued
+#endif
+				shallow = false;
+				wakeup_is_pending = false;
 
-			    if (shutting_down)
-				return;
+				--idle_workers;
+			    }
 
-			    lock.lock();
 			}
 
-			// There is at least one task in the queue and the back is locked.
+			trace_idle_end(worker_index);
+
+			if (shutting_down)
+			    return;
 
-			std::size_t stride =
-			    (maxpart == 0) ? 1 : queue_size / maxpart;
-			if (stride <= 0)
-			    stride = 1;
-			if (stride > functions.capacity())
-			    functions.reserve(2 * stride);
+			lock.lock();
+		    }
 
-			while (stride--)
-			    functions.push(queue.pop());
+		    // There is at least one task in the queue and the back is locked.
+
+		    /*
+		      Guided self-scheduling: the stride shrinks
+		      geometrically with the queue fill level, but
+		      never below min_chunk, so the tail does not
+		      degenerate into single-task grabs under the
+		      pop lock.
+		    */
+		    std::size_t stride =
+			(maxpart == 0) ? 1 : queue_size / maxpart;
+		    if (stride < min_chunk)
+			stride = min_chunk;
+		    if (stride > queue_size)
+			stride = queue_size;
+		    if (stride > functions.capacity())
+			functions.reserve(2 * stride);
+
+		    const std::size_t taken = stride;
+		    while (stride--)
+			functions.push(next_lane().pop());
+
+		    trace_dequeue(worker_index, taken, queue_size - taken);
+
+		    /*
+		      Opportunistically give drained ring segments back
+		      when the pops emptied the queue. The push side is
+		      only try_lock()ed, never waited for, so the pop
+		      path cannot deadlock against the put() lock order.
+		    */
+		    if (queue_empty() && push_mutex.try_lock()) {
+			for (unsigned int i = 0; i != priority_count; ++i)
+			    lane[i]->shrink();
+			push_mutex.unlock();
+		    }
 
-			lock.unlock();
+		    lock.unlock();
+
+		    if (idle_workers && !wakeup_is_pending && queue_size)
+			waiting_workers.notify_one();
 
-			if (idle_workers && !wakeup_is_pending && queue_size)
-			    waiting_workers.notify_one();
+		    if (space_callback_armed.load(std::memory_order_relaxed))
+			notify_space_available();
 
-			while (!functions.empty())
-			    functions.pop()();
+#if defined(THREADPOOL_ENABLE_STATISTICS) && THREADPOOL_ENABLE_STATISTICS
+		    while (!functions.empty()) {
+			std::chrono::steady_clock::time_point t0 =
+			    std::chrono::steady_clock::now();
+			run_one(functions);
+			stat_record_execution(std::chrono::steady_clock::now() - t0);
+			trace_complete(worker_index);
 		    }
+#else
+		    while (!functions.empty()) {
+			run_one(functions);
+			trace_complete(worker_index);
+		    }
+#endif
 		}
+	    }
 
-		/**
-		 * Help, and shut down if an exception escapes.
-		 */
-		void try_help(std::ptrdiff_t return_if_idle) {
-		    try {
-			help(return_if_idle);
-		    } catch (...) {
-			shutdown();
-			throw;
-		    }
+	    /**
+	     * Fire the registered space-available callback if the
+	     * queue has room now. Called by workers after they have
+	     * removed tasks; the callback is invoked outside the
+	     * locks.
+	     */
+	    void notify_space_available() {
+		std::function<void()> callback;
+		{
+		    std::lock_guard<std::mutex> lock(push_mutex);
+		    if (!space_callback
+			|| (queue_depth() >= queue_size && !shutting_down))
+			return;
+		    callback = std::move(space_callback);
+		    space_callback = nullptr;
+		    space_callback_armed.store(false, std::memory_order_relaxed);
 		}
+		callback();
+	    }
 
+	    /**
+	     * Help, and shut down if an exception escapes.
+	     */
+	    void try_help(std::ptrdiff_t return_if_idle) {
+#if THREADPOOL_NOEXCEPT_TASKS
+		help(return_if_idle); // No EH frame on the hot path
+#else
+		try {
+		    help(return_if_idle);
+		} catch (...) {
+		    shutdown();
+		    throw;
+		}
+#endif
+	    }
 
 
-	    public:
 
-		HQueue(std::size_t queue_size, std::size_t maxpart)
-		    : queue_size(queue_size ? queue_size : 10000),
-		      maxpart(maxpart),
-		      shutting_down(false),
-		      idle_workers(0),
-		      total_workers(0),
-		      wakeup_is_pending(false),
-		      queue(this->queue_size)
-		{ }
+	public:
 
-		/**
-		 * Get tasks and execute them. If `return_if_idle`, return
-		 * instead of idly waiting.
-		 */
-		void work(bool return_if_idle) override {
-		    help(return_if_idle ? 0 : -1);
+	    HQueue(std::size_t queue_size, std::size_t maxpart,
+		   std::size_t min_chunk = 1,
+		   std::size_t spin_count = THREADPOOL_SPIN_COUNT,
+		   std::size_t idle_timeout_ms = THREADPOOL_IDLE_TIMEOUT_MS)
+		: queue_size(queue_size ? queue_size : 10000),
+		  maxpart(maxpart),
+		  min_chunk(min_chunk ? min_chunk : 1),
+		  spin_count(spin_count),
+		  idle_timeout_ms(idle_timeout_ms ? idle_timeout_ms : 1),
+		  shutting_down(false),
+		  space_callback_armed(false),
+		  wakeup_is_pending(false),
+		  idle_workers(0),
+		  total_workers(0),
+		  spinning_workers(0),
+		  worker_target(0),
+		  exiting_workers(0),
+		  pending_tasks(0),
+		  quiescent_generation(0),
+		  quiescence_waiters(0),
+		  pop_tick(0),
+		  lanes_high(this->queue_size),
+		  lanes_normal(this->queue_size),
+		  lanes_low(this->queue_size),
+		  lane{&lanes_high, &lanes_normal, &lanes_low}
+	    {
+#if defined(THREADPOOL_ENABLE_STATISTICS) && THREADPOOL_ENABLE_STATISTICS
+		stat_tasks_executed.store(0, std::memory_order_relaxed);
+		stat_wakeups.store(0, std::memory_order_relaxed);
+		stat_idle_time_us.store(0, std::memory_order_relaxed);
+		stat_max_queue_depth.store(0, std::memory_order_relaxed);
+		for (auto& h: stat_histogram)
+		    h.store(0, std::memory_order_relaxed);
+#endif
+	    }
+
+	    /**
+	     * Get tasks and execute them. If `return_if_idle`, return
+	     * instead of idly waiting.
+	     */
+	    void work(bool return_if_idle) override {
+		help(return_if_idle ? 0 : -1);
+	    }
+
+	    /**
+	     * Set the number of workers the queue should retain.
+	     *
+	     * Workers beyond the target retire after they have been
+	     * idle past the idle timeout; 0 restores the fixed
+	     * population. The parked workers are woken so they pick
+	     * up the new target without waiting for task traffic.
+	     */
+	    void set_worker_target(unsigned int target) override {
+		{
+		    std::lock_guard<std::mutex> lock(push_mutex);
+		    worker_target.store(target, std::memory_order_relaxed);
 		}
+		waiting_workers.notify_all();
+	    }
 
-		/**
-		   Enqueue a task.
-		*/
-		template<class C>
-		void put(C&& c) {
+	    /**
+	       Enqueue a task in the normal priority lane.
+	    */
+	    template<class C>
+	    void put(C&& c) {
+		put(Priority::normal, std::forward<C>(c));
+	    }
+
+	    /**
+	       Enqueue a task in a specific priority lane.
+	    */
+	    template<class C>
+	    void put(Priority priority, C&& c) {
+
+		std::unique_lock<std::mutex> lock(push_mutex);
+
+		while (queue_depth() >= queue_size) {
+		    // No space in the queue. Must wait for workers to advance.
 
+		    lock.unlock();
+
+		    try_help(queue_size / 2);
+
+		    lock.lock();
+		}
+
+		// Now there is space in the queue and we have locked the back.
+
+		// Enqueue function.
+		if (shutting_down) {
+
+		    Function fun(std::forward<C>(c)); // Run Function destructor
+
+		} else {
+		    /*
+		      Here we have exclusive access to the head of the
+		      queue.
+		    */
+		    /*
+		      Count the task as pending before it becomes
+		      visible: a worker may pop and finish it before we
+		      return, and the counter must never go below zero.
+		    */
+		    ++pending_tasks;
+		    lane[static_cast<unsigned int>(priority)]->push(std::forward<C>(c));
+		    stat_record_depth(queue_depth());
+		    trace_enqueue(queue_depth());
+
+		    /*
+		      A registered spinner is watching the fill level
+		      right now and parks only after rechecking it under
+		      this lock, so the task is guaranteed to be seen
+		      and the notification can be skipped.
+		    */
+		    if (idle_workers && !wakeup_is_pending
+			&& spinning_workers.load() == 0) {
+			wakeup_is_pending = true;
+			stat_record_wakeups(1);
+			waiting_workers.notify_one();
+		    }
+		}
+	    }
+
+	    /**
+	       Try to enqueue a task in the normal priority lane
+	       without ever blocking or running other tasks.
+	    */
+	    template<class C>
+	    bool try_put(C&& c) {
+		return try_put(Priority::normal, std::forward<C>(c));
+	    }
+
+	    /**
+	     * Try to enqueue a task without ever blocking or running
+	     * other tasks, for submitters like event-loop threads
+	     * that must not be conscripted as helpers.
+	     *
+	     * Returns false and discards the task when the queue is
+	     * at capacity; pair with notify_when_space() to resubmit
+	     * later.
+	     */
+	    template<class C>
+	    bool try_put(Priority priority, C&& c) {
+
+		std::unique_lock<std::mutex> lock(push_mutex);
+
+		if (queue_depth() >= queue_size)
+		    return false;
+
+		if (shutting_down) {
+
+		    Function fun(std::forward<C>(c)); // Run Function destructor
+
+		} else {
+		    /*
+		      Count the task as pending before it becomes
+		      visible: a worker may pop and finish it before we
+		      return, and the counter must never go below zero.
+		    */
+		    ++pending_tasks;
+		    lane[static_cast<unsigned int>(priority)]->push(std::forward<C>(c));
+		    stat_record_depth(queue_depth());
+		    trace_enqueue(queue_depth());
+
+		    /*
+		      A registered spinner is watching the fill level
+		      right now and parks only after rechecking it under
+		      this lock, so the task is guaranteed to be seen
+		      and the notification can be skipped.
+		    */
+		    if (idle_workers && !wakeup_is_pending
+			&& spinning_workers.load() == 0) {
+			wakeup_is_pending = true;
+			stat_record_wakeups(1);
+			waiting_workers.notify_one();
+		    }
+		}
+		return true;
+	    }
+
+	    /**
+	     * Register a one-shot callback to be invoked as soon as
+	     * the queue has space for another task. If there is space
+	     * right now (or the queue is shutting down), the callback
+	     * is invoked immediately on the calling thread; otherwise
+	     * it runs later on whatever worker thread frees the
+	     * space. Only one callback can be armed at a time; a new
+	     * registration replaces a pending one.
+	     */
+	    void notify_when_space(std::function<void()> callback) {
+		{
 		    std::unique_lock<std::mutex> lock(push_mutex);
+		    if (queue_depth() >= queue_size && !shutting_down) {
+			space_callback = std::move(callback);
+			space_callback_armed.store(true, std::memory_order_relaxed);
+			return;
+		    }
+		}
+		callback(); // Space is available right now
+	    }
 
-		    while (queue.size() >= queue_size) {
+	    /**
+	     * Enqueue a batch of tasks.
+	     *
+	     * Takes the push lock once for the whole span instead of
+	     * once per task, and wakes workers once with a wakeup
+	     * sized to the batch. The elements are moved from.
+	     *
+	     * @param first
+	     *			Start of the batch
+	     *
+	     * @param last
+	     *			End of the batch
+	     */
+	    template<class Iterator>
+	    void put_batch(Iterator first, const Iterator& last,
+			   Priority priority = Priority::normal) {
+
+		std::unique_lock<std::mutex> lock(push_mutex);
+
+		while (first != last) {
+
+		    while (queue_depth() >= queue_size) {
 			// No space in the queue. Must wait for workers to advance.
 
 			lock.unlock();
@@ -324,73 +1013,200 @@ namespace ThreadPoolImpl {
 			lock.lock();
 		    }
 
-		    // Now there is space in the queue and we have locked the back.
-
-		    // Enqueue function.
 		    if (shutting_down) {
+			while (first != last) {
+			    Function fun(std::move(*first)); // Run Function destructor
+			    ++first;
+			}
+			return;
+		    }
 
-			Function fun(std::forward<C>(c)); // Run Function destructor
+		    // Fill the available space, then wake workers once.
+		    std::size_t space = queue_size - queue_depth();
+		    std::size_t pushed = 0;
+		    while (first != last && pushed != space) {
+			++pending_tasks; // Before the push; see put()
+			lane[static_cast<unsigned int>(priority)]->push(std::move(*first));
+			++first;
+			++pushed;
+		    }
 
-		    } else {
-			/*
-			  Here we have exclusive access to the head of the
-			  queue.
-			*/
-			queue.push(std::forward<C>(c));
-		
-			if (idle_workers && !wakeup_is_pending) {
-			    wakeup_is_pending = true;
-			    waiting_workers.notify_one();
+		    stat_record_depth(queue_depth());
+		    trace_enqueue(queue_depth());
+
+		    if (idle_workers && !wakeup_is_pending) {
+			wakeup_is_pending = true;
+			if (pushed >= idle_workers) {
+			    stat_record_wakeups(1);
+			    waiting_workers.notify_all();
+			} else {
+			    stat_record_wakeups(pushed);
+			    while (pushed--)
+				waiting_workers.notify_one();
 			}
 		    }
 		}
+	    }
 
-		void shutdown() override {
+	    void shutdown() override {
+		std::function<void()> callback;
+		std::size_t discarded = 0;
+		{
 		    std::unique_lock<std::mutex> push_lock(push_mutex);
 		    std::unique_lock<std::mutex> pop_lock(pop_mutex);
 		    shutting_down = true;
-		    while (!queue.empty())
-			queue.pop();
+		    for (unsigned int i = 0; i != priority_count; ++i)
+			while (!lane[i]->empty()) {
+			    lane[i]->pop();
+			    ++discarded;
+			}
 		    waiting_workers.notify_all();
 		    waiters.notify_all();
+		    callback = std::move(space_callback);
+		    space_callback = nullptr;
+		    space_callback_armed.store(false, std::memory_order_relaxed);
 		}
+		task_finished(discarded); // After the locks; it may notify
+		if (callback)
+		    callback(); // Unblock a waiting submitter
+	    }
 
-		void wait() {
-		    if (std::uncaught_exception())
-			shutdown();
-		    std::exception_ptr e;
-		    std::unique_lock<std::mutex> lock(push_mutex);
-		    while (!queue.empty() || idle_workers != total_workers) {
-			while (!queue.empty()) {
-			    lock.unlock();
-			    try {
-				try_help(0);
-			    } catch (...) {
-				if (e == nullptr)
-				    e = std::current_exception();
-			    }
-			    lock.lock();
+	    void wait() {
+		if (std::uncaught_exception())
+		    shutdown();
+		std::exception_ptr e;
+		std::unique_lock<std::mutex> lock(push_mutex);
+		++quiescence_waiters;
+		while (pending_tasks.load() != 0) {
+		    while (!queue_empty()) {
+			lock.unlock();
+#if THREADPOOL_NOEXCEPT_TASKS
+			try_help(0);
+#else
+			try {
+			    try_help(0);
+			} catch (...) {
+			    if (e == nullptr)
+				e = std::current_exception();
 			}
-			while (idle_workers != total_workers)
-			    waiters.wait(lock);
+#endif
+			lock.lock();
 		    }
-		    if (e != nullptr && !std::uncaught_exception())
-			std::rethrow_exception(std::move(e));
+		    /*
+		      Park on the generation word until the workers have
+		      drained the tasks still in flight. Tasks put() while
+		      we are parked reopen the help loop above, as before.
+		    */
+		    std::size_t generation = quiescent_generation.load();
+		    while (pending_tasks.load() != 0 && queue_empty()
+			   && quiescent_generation.load() == generation)
+			waiters.wait(lock);
 		}
-	    };
+		--quiescence_waiters;
+		lock.unlock();
+		if (e != nullptr && !std::uncaught_exception())
+		    std::rethrow_exception(std::move(e));
+	    }
+
+	    /**
+	     * Number of tasks put() but not yet finished, whether
+	     * still queued, prefetched or executing. A single relaxed
+	     * atomic load, safe to poll from monitoring threads at any
+	     * rate without touching a mutex.
+	     */
+	    std::size_t pending() const {
+		return pending_tasks.load(std::memory_order_relaxed);
+	    }
+
+	    /**
+	     * Whether the queue currently appears empty: an
+	     * unsynchronized probe of the lane fill levels, with the
+	     * same benign imprecision as the spin phase of help().
+	     * For callers layering their own wakeup protocol on top,
+	     * like the parking loop of the NUMA pool.
+	     */
+	    bool appears_empty() const {
+		return queue_empty();
+	    }
+
+	    /**
+	     * Take a snapshot of the runtime statistics.
+	     *
+	     * The instantaneous values are read under the push lock;
+	     * the counters are read relaxed, so a snapshot taken while
+	     * the pool is busy is consistent only approximately.
+	     */
+	    ThreadPoolStatistics statistics() {
+		ThreadPoolStatistics s;
+		{
+		    std::lock_guard<std::mutex> lock(push_mutex);
+		    s.queue_depth = queue_depth();
+		    s.total_workers = total_workers;
+		    s.idle_workers = idle_workers;
+		}
+		s.queue_capacity = queue_size;
+#if defined(THREADPOOL_ENABLE_STATISTICS) && THREADPOOL_ENABLE_STATISTICS
+		s.max_queue_depth = stat_max_queue_depth.load(std::memory_order_relaxed);
+		s.tasks_executed = stat_tasks_executed.load(std::memory_order_relaxed);
+		s.wakeups = stat_wakeups.load(std::memory_order_relaxed);
+		s.idle_time_us = stat_idle_time_us.load(std::memory_order_relaxed);
+		for (unsigned int i = 0; i != ThreadPoolStatistics::histogram_buckets; ++i)
+		    s.execution_time_histogram[i] =
+			stat_histogram[i].load(std::memory_order_relaxed);
+#endif
+		return s;
+	    }
+	};
+
+
 
-	    HQueue queue;
+
+
+	/**
+	 * Thread pool with homogenous functions
+	 *
+	 * This thread pool is dependent on template parameter
+	 * Function. Only one type of functions can be queued. For
+	 * example if this thread pool is instantiated for a lambda
+	 * function, only this exact lambda function can be run,
+	 * since each lambda function has its own type separate from
+	 * all other lambda functions.
+	 *
+	 * To make this thread pool more universally usable,
+	 * instantiate it either with std::function<void()>, or use
+	 * the virtual thread pool VirtualThreadPool.
+	 *
+	 * @tparam Function
+	 *		The function type to be used for the
+	 *		queue. All tasks to be queued must be of this
+	 *		type. The class Function must support the
+	 *		following interface:
+	 *		- operator()(): the functions must be callable
+	 *		  with no parameters.
+	 *
+	 * @tparam Queue
+	 *		The queue used to pass the functions to the
+	 *		worker threads. Defaults to the mutex-based
+	 *		HQueue; LockfreeHQueue from
+	 *		threadpool_impl_lockfree.h can be selected
+	 *		instead on platforms with lock-free atomics.
+	 */
+	template<class Function, class Queue = HQueue<Function> >
+	class HomogenousThreadPool {
+
+	    Queue queue;
 	    GenericThreadPool pool;
 
 	public:
 
 	    explicit HomogenousThreadPool(int thread_count = -1,
 					  std::size_t queue_size = 0,
-					  std::size_t maxpart = 1)
+					  std::size_t maxpart = 1,
+					  ThreadOptions thread_options = ThreadOptions())
 		: queue(queue_size,
 			(maxpart != 1) ? maxpart
 			: 3 * (GenericThreadPool::determine_thread_count(thread_count)+ 1)),
-		  pool(queue, thread_count)
+		  pool(queue, thread_count, std::move(thread_options))
 	    { }
 
 	    template<class F>
@@ -398,6 +1214,65 @@ namespace ThreadPoolImpl {
 		queue.put(std::forward<F>(f));
 	    }
 
+	    /**
+	     * Run a task in a specific priority lane. Only available
+	     * if the Queue type supports priorities.
+	     */
+	    template<class F>
+	    void run(Priority priority, F&& f) {
+		queue.put(priority, std::forward<F>(f));
+	    }
+
+	    /**
+	     * Try to run a task without ever blocking or running
+	     * other tasks on the calling thread. Returns false and
+	     * discards the task when the queue is at capacity. Only
+	     * available if the Queue type supports it.
+	     */
+	    template<class F>
+	    bool try_run(F&& f) {
+		return queue.try_put(std::forward<F>(f));
+	    }
+
+	    template<class F>
+	    bool try_run(Priority priority, F&& f) {
+		return queue.try_put(priority, std::forward<F>(f));
+	    }
+
+	    /**
+	     * Register a one-shot callback invoked as soon as the
+	     * queue has space for another task; see
+	     * HQueue::notify_when_space(). Only available if the
+	     * Queue type supports it.
+	     */
+	    void notify_when_space(std::function<void()> callback) {
+		queue.notify_when_space(std::move(callback));
+	    }
+
+	    /**
+	     * Run a batch of tasks, taking the queue lock only once.
+	     *
+	     * The elements of the range are moved into the queue.
+	     * Only available if the Queue type supports put_batch().
+	     */
+	    template<class Iterator>
+	    void run_batch(Iterator first, const Iterator& last) {
+		queue.put_batch(first, last);
+	    }
+
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking lets the surplus workers retire after they
+	     * have been idle past the idle timeout; see
+	     * HQueue::set_worker_target(). Only available if the
+	     * Queue type supports idle-thread reclamation.
+	     */
+	    void resize(std::size_t thread_count) {
+		pool.resize(thread_count);
+	    }
+
 	    void wait() {
 		pool.help(true); 	// Help out instead of sitting around idly.
 		queue.wait();
@@ -408,6 +1283,22 @@ namespace ThreadPoolImpl {
 		pool.join();
 	    }
 
+	    /**
+	     * Take a snapshot of the queue's runtime statistics.
+	     * Only available if the Queue type supports statistics().
+	     */
+	    ThreadPoolStatistics statistics() {
+		return queue.statistics();
+	    }
+
+	    /**
+	     * Number of tasks submitted but not yet finished; a single
+	     * atomic load. Only available if the Queue type supports it.
+	     */
+	    std::size_t pending() const {
+		return queue.pending();
+	    }
+
 	    virtual ~HomogenousThreadPool() {
 		wait();
 		join();
@@ -0,0 +1,426 @@
+/** @file threadpool/impl/threadpool_impl_numa.h
+ *
+ * Threadpool for C++11, NUMA-aware thread pool with per-node queue shards
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_NUMA_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_NUMA_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+#include "threadpool_generic.h"
+#include "threadpool_impl_homogenous.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  Thread pinning is done with pin_current_thread_to_cpus()
+	  from threadpool_impl_util.h.
+	*/
+
+	/**
+	 * NUMA topology of the machine.
+	 *
+	 * Discovered once from /sys/devices/system/node on Linux. On
+	 * other systems, or when the sysfs nodes are not available,
+	 * the machine is treated as a single node containing all
+	 * hardware threads, which makes the NUMA pool degenerate to
+	 * the ordinary flat pool.
+	 */
+	class NumaTopology {
+
+	    std::vector<std::vector<unsigned int> > cpus_of_node;
+	    std::vector<unsigned int> node_of_cpu_map;
+
+	    /**
+	     * Parse a sysfs cpulist like "0-15,32-47".
+	     */
+	    static std::vector<unsigned int> parse_cpulist(const std::string& s) {
+		std::vector<unsigned int> cpus;
+		std::istringstream in(s);
+		std::string part;
+		while (std::getline(in, part, ',')) {
+		    unsigned long a, b;
+		    char dash;
+		    std::istringstream p(part);
+		    if (!(p >> a))
+			continue;
+		    if (p >> dash >> b) {
+			for (unsigned long c = a; c <= b; ++c)
+			    cpus.push_back(static_cast<unsigned int>(c));
+		    } else {
+			cpus.push_back(static_cast<unsigned int>(a));
+		    }
+		}
+		return cpus;
+	    }
+
+	    NumaTopology() {
+		for (unsigned int node = 0; ; ++node) {
+		    std::ostringstream path;
+		    path << "/sys/devices/system/node/node" << node << "/cpulist";
+		    std::ifstream f(path.str().c_str());
+		    if (!f)
+			break;
+		    std::string line;
+		    std::getline(f, line);
+		    std::vector<unsigned int> cpus = parse_cpulist(line);
+		    if (!cpus.empty())
+			cpus_of_node.push_back(std::move(cpus));
+		}
+
+		if (cpus_of_node.empty()) {
+		    // No NUMA information, treat as one node.
+		    unsigned int n = GenericThreadPool::hardware_concurrency();
+		    std::vector<unsigned int> cpus;
+		    for (unsigned int c = 0; c != n; ++c)
+			cpus.push_back(c);
+		    cpus_of_node.push_back(std::move(cpus));
+		}
+
+		unsigned int max_cpu = 0;
+		for (const auto& cpus: cpus_of_node)
+		    for (unsigned int c: cpus)
+			if (c > max_cpu)
+			    max_cpu = c;
+		node_of_cpu_map.assign(max_cpu + 1, 0);
+		for (unsigned int node = 0; node != cpus_of_node.size(); ++node)
+		    for (unsigned int c: cpus_of_node[node])
+			node_of_cpu_map[c] = node;
+	    }
+
+	public:
+
+	    static const NumaTopology& instance() {
+		static const NumaTopology topology;
+		return topology;
+	    }
+
+	    /** The number of NUMA nodes, at least 1. */
+	    unsigned int node_count() const {
+		return cpus_of_node.size();
+	    }
+
+	    /** The CPUs belonging to a node. */
+	    const std::vector<unsigned int>& node_cpus(unsigned int node) const {
+		return cpus_of_node[node];
+	    }
+
+	    /** The node a CPU belongs to. */
+	    unsigned int node_of_cpu(unsigned int cpu) const {
+		return cpu < node_of_cpu_map.size() ? node_of_cpu_map[cpu] : 0;
+	    }
+
+	    /**
+	     * The node the calling thread currently runs on.
+	     *
+	     * Falls back to spreading callers round-robin over the
+	     * nodes when the current CPU can not be determined.
+	     */
+	    unsigned int current_node() const {
+#ifdef __linux__
+		int cpu = sched_getcpu();
+		if (cpu >= 0)
+		    return node_of_cpu(static_cast<unsigned int>(cpu));
+#endif
+		static std::atomic<unsigned int> next(0);
+		return next.fetch_add(1) % node_count();
+	    }
+
+	    /**
+	     * Per-node share of a requested total thread count.
+	     *
+	     * With the default of -1, each node gets one thread per
+	     * CPU of the node. An explicit total is distributed over
+	     * the nodes as evenly as possible.
+	     *
+	     * @param node
+	     *			The node to report the count for.
+	     *
+	     * @param thread_count
+	     *			The requested total thread count, or
+	     *			-1 for one thread per CPU.
+	     */
+	    unsigned int node_thread_count(unsigned int node, int thread_count = -1) const {
+		if (thread_count < 0)
+		    return cpus_of_node[node].size();
+		unsigned int n = node_count();
+		unsigned int count = static_cast<unsigned int>(thread_count);
+		return count / n + (node < count % n ? 1 : 0);
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Thread pool with per-NUMA-node worker groups and queue
+	 * shards.
+	 *
+	 * One HQueue shard and one group of workers per NUMA node;
+	 * the workers are pinned to the CPUs of their node, so a
+	 * task submitted from a node is normally fetched and run on
+	 * the same node and its queue slots and payload stay in
+	 * node-local memory. run() routes each task to the
+	 * submitter's node. When a shard runs dry, its workers sweep
+	 * the other shards and execute their tasks before parking on
+	 * the node's condition variable, so no node sits idle while
+	 * another is loaded.
+	 *
+	 * On machines without NUMA information this degenerates to a
+	 * single shard and behaves like HomogenousThreadPool.
+	 *
+	 * @tparam Function
+	 *		The function type to queue, as in
+	 *		HomogenousThreadPool.
+	 */
+	template<class Function>
+	class NumaThreadPool {
+
+	    typedef HQueue<Function> LocalQueue;
+
+	    /**
+	     * The queue a node's worker group pulls from: drains the
+	     * local shard, steals from the other shards when it runs
+	     * dry, and parks on the node's condition variable when
+	     * everything is empty.
+	     */
+	    class ShardQueue : public GenericThreadPoolQueue {
+
+		NumaThreadPool& pool;
+		const unsigned int node;
+
+	    public:
+
+		ShardQueue(NumaThreadPool& pool, unsigned int node)
+		    : pool(pool), node(node) { }
+
+		void work(bool return_if_idle) override {
+		    if (return_if_idle) { // Helping from wait(): local shard only
+			pool.shards[node]->work(true);
+			return;
+		    }
+
+		    if (!pool.shutting_down.load())
+			pin_current_thread_to_cpus(NumaTopology::instance().node_cpus(node));
+
+		    const unsigned int n = pool.shards.size();
+		    for (;;) {
+			pool.shards[node]->work(true); // Drain the local shard
+
+			for (unsigned int i = 1; i != n; ++i) // Steal sweep
+			    pool.shards[(node + i) % n]->work(true);
+
+			if (pool.shutting_down.load())
+			    return;
+
+			/*
+			  Everything appeared empty: park on the
+			  node's condition variable until run()
+			  submits again. Eventcount protocol as in
+			  the flat queues: register as idle with a
+			  sequentially consistent increment BEFORE
+			  re-checking the shards, paired with the
+			  fence in wake(). Either the producer sees
+			  our registration and notifies, or we see
+			  its task and do not park; checking first
+			  would let a task slip in between and sit
+			  unserved while every worker sleeps.
+			*/
+			ParkState& park = *pool.parking[node];
+			std::unique_lock<std::mutex> lock(park.park_mutex);
+			park.idle_workers.fetch_add(1);
+			while (pool.all_shards_appear_empty()
+			       && !pool.shutting_down.load())
+			    park.waiting_workers.wait(lock);
+			park.idle_workers.fetch_sub(1, std::memory_order_relaxed);
+		    }
+		}
+
+		void shutdown() override {
+		    // A failing worker shuts the whole pool down.
+		    pool.shutting_down.store(true);
+		    for (auto& shard: pool.shards)
+			shard->shutdown();
+		    pool.wake_all();
+		}
+	    };
+
+	    /**
+	     * Parking of a node's idle workers. One state per node,
+	     * so a wakeup targets the node the work arrived on and
+	     * the parking traffic of one node does not rattle the
+	     * cache lines of another.
+	     */
+	    struct ParkState {
+		std::mutex park_mutex;
+		std::condition_variable waiting_workers;
+		std::atomic<unsigned int> idle_workers;
+		ParkState() : idle_workers(0) { }
+	    };
+
+	    const NumaTopology& topology;
+	    std::atomic<bool> shutting_down;
+	    std::vector<std::unique_ptr<LocalQueue> > shards;
+	    std::vector<std::unique_ptr<ParkState> > parking;
+	    std::vector<std::unique_ptr<ShardQueue> > shard_queues;
+	    std::vector<std::unique_ptr<GenericThreadPool> > groups;
+
+	    bool all_shards_appear_empty() const {
+		for (const auto& shard: shards)
+		    if (!shard->appears_empty())
+			return false;
+		return true;
+	    }
+
+	    /**
+	     * Wake a parked worker after a task became visible on
+	     * `node`'s shard: preferably one of the node's own
+	     * workers, otherwise any other node's, which reaches the
+	     * task through its steal sweep (a node's share of an
+	     * explicit thread count can be zero). The fence is the
+	     * eventcount pairing with the parking loop in
+	     * ShardQueue::work(): it orders the put() before the
+	     * idle_workers loads, and a parking worker registers
+	     * before it re-checks the shards, so either we see the
+	     * registration and notify, or the worker sees the task
+	     * and does not park.
+	     */
+	    void wake(unsigned int node) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const unsigned int n = parking.size();
+		for (unsigned int i = 0; i != n; ++i) {
+		    ParkState& park = *parking[(node + i) % n];
+		    if (park.idle_workers.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(park.park_mutex);
+			park.waiting_workers.notify_one();
+			return;
+		    }
+		}
+	    }
+
+	    /**
+	     * Wake every parked worker, for shutdown.
+	     */
+	    void wake_all() {
+		for (auto& park: parking) {
+		    std::lock_guard<std::mutex> lock(park->park_mutex);
+		    park->waiting_workers.notify_all();
+		}
+	    }
+
+	public:
+
+	    explicit NumaThreadPool(int thread_count = -1,
+				    std::size_t queue_size = 0,
+				    std::size_t maxpart = 1)
+		: topology(NumaTopology::instance()),
+		  shutting_down(false)
+	    {
+		unsigned int nodes = topology.node_count();
+		for (unsigned int node = 0; node != nodes; ++node) {
+		    unsigned int tc = topology.node_thread_count(node, thread_count);
+		    shards.emplace_back(new LocalQueue(queue_size,
+						       (maxpart != 1) ? maxpart
+						       : 3 * (tc + 1)));
+		    parking.emplace_back(new ParkState);
+		    shard_queues.emplace_back(new ShardQueue(*this, node));
+		}
+		// All shards exist before the first worker starts.
+		for (unsigned int node = 0; node != nodes; ++node)
+		    groups.emplace_back(new GenericThreadPool(*shard_queues[node],
+							      topology.node_thread_count(node, thread_count)));
+	    }
+
+	    /**
+	     * Run a task, enqueued on the shard of the node the
+	     * caller runs on.
+	     */
+	    template<class F>
+	    void run(F&& f) {
+		unsigned int node = topology.current_node() % shards.size();
+		shards[node]->put(std::forward<F>(f));
+		wake(node);
+	    }
+
+	    /**
+	     * Wait for all tasks on all shards to finish.
+	     */
+	    void wait() {
+		for (auto& shard: shards)
+		    shard->wait();
+	    }
+
+	    /**
+	     * Discard all queued tasks and collect the workers.
+	     */
+	    void join() {
+		shutting_down.store(true);
+		for (auto& shard: shards)
+		    shard->shutdown();
+		wake_all();
+		for (auto& group: groups)
+		    group->join();
+	    }
+
+	    virtual ~NumaThreadPool() {
+		wait();
+		join();
+	    }
+
+	    /**
+	     * Run a function on all members of a container
+	     *
+	     * @param container
+	     *			The container to process
+	     * @param fun
+	     *			The function taking one parameter
+	     *			by reference and returning void.
+	     *
+	     * Does not wait for all tasks to finish! Caller is
+	     * responsible for wait()ing on the pool if necessary.
+	     */
+	    template<class Container, class F>
+	    F run_for_each(Container&& container, F&& fun) {
+		for (auto& e: container)
+		    run([&fun,&e](){
+			    fun(e);
+			});
+		return std::forward<F>(fun);
+	    }
+
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_NUMA_H)
@@ -0,0 +1,174 @@
+/** @file threadpool/impl/threadpool_impl_shared.h
+ *
+ * Threadpool for C++11, shared pool for the one-shot algorithms
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_SHARED_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_SHARED_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include "../threadpool.h"
+#include "threadpool_interface_generic.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  The one-shot algorithms parallel::for_each(),
+	  parallel::transform() and parallel::reduce() used to spawn a
+	  fresh set of std::threads on every call and join them at the
+	  end. Thread creation costs far more than the work of a
+	  medium-sized loop, so for algorithms called at high frequency
+	  the free functions borrow the workers of a process-wide pool
+	  instead. The pool is created lazily on first use and lives
+	  until the end of the process.
+	*/
+
+	/**
+	 * The process-wide shared thread pool.
+	 *
+	 * Created on first use with the default thread count (one
+	 * worker per hardware thread). The one-shot algorithm free
+	 * functions borrow its workers when no explicit thread count
+	 * is requested; it can also be used directly to run tasks.
+	 */
+	inline VirtualThreadPool<>& shared_pool() {
+	    static VirtualThreadPool<> pool;
+	    return pool;
+	}
+
+
+
+	/**
+	 * Run an algorithm queue to completion on the workers of the
+	 * shared pool.
+	 *
+	 * Submits `thread_count` driver tasks to the shared pool, each
+	 * of which works on the queue until the input range is
+	 * exhausted. The caller helps too, and afterwards waits only
+	 * for the drivers still inside work(). Drivers that have not
+	 * started by then find the control block closed and return
+	 * without touching the queue, which lives on the caller's
+	 * stack and is gone when this function returns.
+	 *
+	 * An exception from the queue shuts the queue down, as in
+	 * GenericThreadPoolImpl::help(), and is rethrown here in the
+	 * caller; it never reaches the shared pool's own exception
+	 * handling, so one failing algorithm does not poison the pool.
+	 *
+	 * @param queue
+	 *		The queue delivering the tasks. Must return
+	 *		from work() when the input is exhausted.
+	 *
+	 * @param thread_count
+	 *		The number of driver tasks to submit.
+	 */
+	inline void run_on_shared_pool(GenericThreadPoolQueue& queue,
+				       unsigned int thread_count) {
+
+	    struct Control {
+		std::mutex mutex;
+		std::condition_variable finished;
+		GenericThreadPoolQueue* queue; // Null when the caller has left
+		unsigned int active;	       // Drivers inside work()
+		std::exception_ptr pending_exception;
+
+		Control(GenericThreadPoolQueue* queue)
+		    : queue(queue), active(0) { }
+	    };
+
+	    std::shared_ptr<Control> control = std::make_shared<Control>(&queue);
+	    VirtualThreadPool<>& pool = shared_pool();
+
+	    for (unsigned int i = 0; i != thread_count; ++i) {
+		pool.run([control]() {
+			GenericThreadPoolQueue* q;
+			{
+			    std::lock_guard<std::mutex> lock(control->mutex);
+			    if (!(q = control->queue))
+				return; // Too late, the queue is gone
+			    ++control->active;
+			}
+			try {
+			    q->work(false);
+			} catch (...) {
+			    {
+				std::lock_guard<std::mutex> lock(control->mutex);
+				if (!control->pending_exception)
+				    control->pending_exception = std::current_exception();
+			    }
+			    q->shutdown();
+			}
+			std::lock_guard<std::mutex> lock(control->mutex);
+			--control->active;
+			control->finished.notify_all();
+		    });
+	    }
+
+	    try { // Instead of hanging around, help the workers!
+		queue.work(false);
+	    } catch (...) {
+		{
+		    std::lock_guard<std::mutex> lock(control->mutex);
+		    if (!control->pending_exception)
+			control->pending_exception = std::current_exception();
+		}
+		queue.shutdown();
+	    }
+
+	    std::unique_lock<std::mutex> lock(control->mutex);
+	    control->queue = nullptr;
+	    while (control->active != 0)
+		control->finished.wait(lock);
+	    std::exception_ptr e = std::move(control->pending_exception);
+	    lock.unlock();
+	    if (e)
+		std::rethrow_exception(std::move(e));
+	}
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+
+
+/*
+  Export the shared pool to namespace `threadpool::parallel`, where
+  the free functions using it live.
+*/
+namespace threadpool {
+
+    namespace parallel {
+
+	/**
+	 * The process-wide shared thread pool used by the one-shot
+	 * algorithms, for users who want to run their own tasks on it.
+	 */
+	inline ::threadpool::ThreadPool& shared_pool() {
+	    return ThreadPoolImpl::impl::shared_pool();
+	}
+
+    } // End of namespace parallel
+
+} // End of namespace threadpool
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_SHARED_H)
@@ -0,0 +1,405 @@
+/** @file threadpool/impl/threadpool_impl_singleproducer.h
+ *
+ * Threadpool for C++11, single-producer queue for the homogenous pool
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_SINGLEPRODUCER_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_SINGLEPRODUCER_H
+
+#include <cassert>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+
+#include "threadpool_generic.h"
+#include "threadpool_impl_util.h"
+#include "threadpool_impl_homogenous.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  Many pools are fed by exactly one submitter thread, yet the
+	  mutex-based HQueue takes push_mutex on every put() and even
+	  the lock-free MPMC ring pays one compare-exchange per
+	  enqueue to arbitrate between producers that do not
+	  exist. With a single producer the enqueue position has one
+	  writer only, so the producer can claim the slot with plain
+	  loads and publish it with release stores: a wait-free
+	  submission path. The consumer side keeps the same per-slot
+	  sequence arbitration as the lock-free MPMC ring, so any
+	  number of workers can drain the queue. Mutexes remain only
+	  on the slow path, for parking idle workers and waiters.
+
+	  The queue is selected through the second template parameter
+	  of HomogenousThreadPool. The caller guarantees that put()
+	  and wait() are only ever called from one thread; this is
+	  not checked. On platforms whose atomics are not lock-free
+	  SingleProducerHQueue falls back to the mutex-based HQueue.
+	*/
+
+#if defined(ATOMIC_POINTER_LOCK_FREE) && ATOMIC_POINTER_LOCK_FREE == 2 \
+    && defined(ATOMIC_LONG_LOCK_FREE) && ATOMIC_LONG_LOCK_FREE == 2
+
+#define THREADPOOL_HAVE_SINGLEPRODUCER_QUEUE 1
+
+	/**
+	 * Bounded SPMC queue for functions with signature void()
+	 *
+	 * Drop-in alternative to HQueue for HomogenousThreadPool
+	 * when all tasks are submitted from one thread. put() is
+	 * wait-free: the producer writes the enqueue position with
+	 * release stores and never takes a lock and never loops on a
+	 * compare-exchange. Task retrieval is lock-free and
+	 * multi-consumer; a mutex and condition variables are only
+	 * used to park workers when the queue is empty and to park
+	 * waiters in wait().
+	 *
+	 * put() and wait() must only be called from the single
+	 * producer thread.
+	 *
+	 * @tparam Function
+	 *		The function type to queue.
+	 */
+	template<class Function>
+	class SingleProducerHQueue : public GenericThreadPoolQueue {
+
+	    /*
+	      One slot of the ring. The sequence number encodes the
+	      slot state: == pos for an empty slot ready for the
+	      producer, == pos + 1 for a full slot ready for the
+	      consumer with that ticket.
+	    */
+	    struct Slot {
+		std::atomic<std::size_t> sequence;
+		alignas(Function) char storage[sizeof(Function)];
+	    };
+
+	    const std::size_t queue_size;	// Capacity bound for put()
+	    const std::size_t ring_size;	// Power of two >= queue_size
+	    const std::size_t ring_mask;
+	    std::unique_ptr<Slot[]> ring;
+
+	    /*
+	      Only the producer writes enqueue_pos; it is atomic so
+	      the workers can read the approximate fill level.
+	    */
+	    std::atomic<std::size_t> enqueue_pos;
+	    std::atomic<std::size_t> dequeue_pos;
+	    std::atomic<std::size_t> pending;	// Queued or running tasks
+	    std::atomic<unsigned int> idle_workers;
+	    std::atomic<bool> shutting_down;
+
+	    // Slow path only: parking of idle workers and waiters
+	    std::mutex park_mutex;
+	    std::condition_variable waiting_workers;
+	    std::condition_variable waiters;
+
+	    static std::size_t round_up_pow2(std::size_t s) {
+		std::size_t r = 1;
+		while (r < s)
+		    r <<= 1;
+		return r;
+	    }
+
+	    Function& slot_function(Slot& s) {
+		return reinterpret_cast<Function&>(s.storage);
+	    }
+
+	    /**
+	     * Try to enqueue a function. Fails when the ring is
+	     * full. Wait-free: no lock, no compare-exchange loop.
+	     */
+	    template<class C>
+	    bool try_push(C&& c) {
+		std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		Slot& s = ring[pos & ring_mask];
+		if (s.sequence.load(std::memory_order_acquire) != pos)
+		    return false; // Ring is full
+		new (&s.storage) Function(std::forward<C>(c));
+		s.sequence.store(pos + 1, std::memory_order_release);
+		enqueue_pos.store(pos + 1, std::memory_order_release);
+		return true;
+	    }
+
+	    /**
+	     * Dequeue and run one task. Returns false when the queue
+	     * is empty. The `pending` count is released even if the
+	     * task throws.
+	     */
+	    bool run_one() {
+		std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+		    Slot& s = ring[pos & ring_mask];
+		    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+		    std::ptrdiff_t dif = static_cast<std::ptrdiff_t>(seq)
+			- static_cast<std::ptrdiff_t>(pos + 1);
+		    if (dif == 0) {
+			if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+							      std::memory_order_relaxed))
+			    break;
+		    } else if (dif < 0) {
+			return false; // Ring is empty
+		    } else {
+			pos = dequeue_pos.load(std::memory_order_relaxed);
+		    }
+		}
+		Slot& s = ring[pos & ring_mask];
+		Function f = std::move(slot_function(s));
+		slot_function(s).~Function();
+		s.sequence.store(pos + ring_mask + 1, std::memory_order_release);
+		auto x1 = at_scope_exit([this](){ this->release_pending(); });
+		f();
+		return true;
+	    }
+
+	    /**
+	     * Dequeue and destroy one task without running it. Used
+	     * by shutdown() and the destructor.
+	     */
+	    bool discard_one() {
+		std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		for (;;) {
+		    Slot& s = ring[pos & ring_mask];
+		    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+		    std::ptrdiff_t dif = static_cast<std::ptrdiff_t>(seq)
+			- static_cast<std::ptrdiff_t>(pos + 1);
+		    if (dif == 0) {
+			if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+							      std::memory_order_relaxed))
+			    break;
+		    } else if (dif < 0) {
+			return false;
+		    } else {
+			pos = dequeue_pos.load(std::memory_order_relaxed);
+		    }
+		}
+		Slot& s = ring[pos & ring_mask];
+		slot_function(s).~Function();
+		s.sequence.store(pos + ring_mask + 1, std::memory_order_release);
+		release_pending();
+		return true;
+	    }
+
+	    /**
+	     * A task is done or discarded. Wake the waiters when the
+	     * last one finishes.
+	     */
+	    void release_pending() {
+		if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		    std::lock_guard<std::mutex> lock(park_mutex);
+		    waiters.notify_all();
+		}
+	    }
+
+	    /**
+	     * Get tasks and execute them. Return as soon as the queue
+	     * shrinks to `return_if_idle` tasks.
+	     */
+	    void help(std::ptrdiff_t return_if_idle) {
+		for (;;) {
+		    if (!run_one()) {
+			if (return_if_idle >= 0)
+			    return;
+
+			// The queue is empty, wait for more tasks to be put()
+			std::unique_lock<std::mutex> lock(park_mutex);
+			/*
+			  Eventcount protocol: register as idle with a
+			  sequentially consistent increment BEFORE
+			  re-checking the fill level, paired with the
+			  fence between push and idle_workers load in
+			  put(). Either the producer sees our
+			  registration and notifies, or we see its task
+			  and do not park. Checking first would let a
+			  task slip between the check and the
+			  registration, and with a single producer by
+			  contract no later put() would ever arrive to
+			  deliver the missed wakeup.
+			*/
+			idle_workers.fetch_add(1);
+			while (approximate_size() == 0
+			       && !shutting_down.load(std::memory_order_relaxed))
+			    waiting_workers.wait(lock);
+			idle_workers.fetch_sub(1, std::memory_order_relaxed);
+			if (shutting_down.load(std::memory_order_relaxed))
+			    return;
+		    } else {
+			if (return_if_idle > 0
+			    && approximate_size() <= static_cast<std::size_t>(return_if_idle))
+			    return;
+		    }
+		}
+	    }
+
+	    /**
+	     * Help, and shut down if an exception escapes.
+	     */
+	    void try_help(std::ptrdiff_t return_if_idle) {
+		try {
+		    help(return_if_idle);
+		} catch (...) {
+		    shutdown();
+		    throw;
+		}
+	    }
+
+	    std::size_t approximate_size() const {
+		std::size_t e = enqueue_pos.load(std::memory_order_relaxed);
+		std::size_t d = dequeue_pos.load(std::memory_order_relaxed);
+		return (e > d) ? e - d : 0;
+	    }
+
+
+
+	public:
+
+	    SingleProducerHQueue(std::size_t queue_size, std::size_t /*maxpart*/)
+		: queue_size(queue_size ? queue_size : 10000),
+		  ring_size(round_up_pow2(this->queue_size)),
+		  ring_mask(ring_size - 1),
+		  ring(new Slot[ring_size]),
+		  enqueue_pos(0),
+		  dequeue_pos(0),
+		  pending(0),
+		  idle_workers(0),
+		  shutting_down(false)
+	    {
+		for (std::size_t i = 0; i != ring_size; ++i)
+		    ring[i].sequence.store(i, std::memory_order_relaxed);
+	    }
+
+	    /**
+	     * Get tasks and execute them. If `return_if_idle`, return
+	     * instead of idly waiting.
+	     */
+	    void work(bool return_if_idle) override {
+		help(return_if_idle ? 0 : -1);
+	    }
+
+	    /**
+	       Enqueue a task. Must only be called from the single
+	       producer thread.
+	    */
+	    template<class C>
+	    void put(C&& c) {
+
+		if (shutting_down.load(std::memory_order_relaxed)) {
+		    Function fun(std::forward<C>(c)); // Run Function destructor
+		    return;
+		}
+
+		pending.fetch_add(1, std::memory_order_relaxed);
+
+		while (approximate_size() >= queue_size || !try_push(std::forward<C>(c))) {
+		    // No space in the queue. Help the workers to advance.
+		    pending.fetch_sub(1, std::memory_order_relaxed);
+
+		    try_help(queue_size / 2);
+
+		    if (shutting_down.load(std::memory_order_relaxed)) {
+			Function fun(std::forward<C>(c)); // Run Function destructor
+			return;
+		    }
+
+		    pending.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/*
+		  Eventcount pairing with the parking loop in help():
+		  the fence orders the push before the idle_workers
+		  load, and a parking worker registers with a
+		  sequentially consistent increment before it re-checks
+		  the fill level. Either we see the registration and
+		  notify, or the worker sees our task and does not
+		  park; without the fence both loads could pass each
+		  other, and the single producer would never submit
+		  again to deliver the missed wakeup.
+		*/
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (idle_workers.load(std::memory_order_relaxed)) {
+		    std::lock_guard<std::mutex> lock(park_mutex);
+		    waiting_workers.notify_one();
+		}
+	    }
+
+	    void shutdown() override {
+		shutting_down.store(true, std::memory_order_relaxed);
+		while (discard_one())
+		    ;
+		std::lock_guard<std::mutex> lock(park_mutex);
+		waiting_workers.notify_all();
+		waiters.notify_all();
+	    }
+
+	    void wait() {
+		if (std::uncaught_exception())
+		    shutdown();
+		std::exception_ptr e;
+		while (pending.load(std::memory_order_acquire) != 0) {
+		    try {
+			while (run_one())
+			    ;
+		    } catch (...) {
+			if (e == nullptr)
+			    e = std::current_exception();
+			shutdown();
+		    }
+		    std::unique_lock<std::mutex> lock(park_mutex);
+		    if (pending.load(std::memory_order_acquire) != 0
+			&& approximate_size() == 0)
+			waiters.wait(lock);
+		}
+		if (e != nullptr && !std::uncaught_exception())
+		    std::rethrow_exception(std::move(e));
+	    }
+
+	    virtual ~SingleProducerHQueue() {
+		while (discard_one())
+		    ;
+	    }
+	};
+
+#else // No lock-free atomics, fall back to the mutex-based queue
+
+#define THREADPOOL_HAVE_SINGLEPRODUCER_QUEUE 0
+
+	template<class Function>
+	using SingleProducerHQueue = HQueue<Function>;
+
+#endif // Lock-free atomics
+
+
+
+
+
+	/**
+	 * A homogenous thread pool fed from a single submitter
+	 * thread through the wait-free SPMC queue.
+	 */
+	template<class Function>
+	using SingleProducerHomogenousThreadPool
+	    = HomogenousThreadPool<Function, SingleProducerHQueue<Function> >;
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_SINGLEPRODUCER_H)
@@ -0,0 +1,191 @@
+/** @file threadpool/impl/threadpool_impl_task_group.h
+ *
+ * Threadpool for C++11, scoped task groups
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_TASK_GROUP_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_TASK_GROUP_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "../threadpool_config.h"
+#include "threadpool_interface_virtual.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/**
+	 * Scoped wait set on a shared pool.
+	 *
+	 * The pool-wide wait() waits for every queued task, so two
+	 * independent subsystems sharing one pool stall on each
+	 * other's work. A TaskGroup tags the tasks submitted through
+	 * it with a per-group pending counter; group.wait() blocks
+	 * only until that counter drains, no matter what else is in
+	 * the queue. This makes one big shared pool practical where
+	 * per-subsystem pools were used only to get independent
+	 * waiting.
+	 *
+	 * The first exception thrown by a task of the group is
+	 * captured and rethrown by wait(), like the pool-wide
+	 * pending-exception logic; later exceptions of the same
+	 * group are dropped. Tasks discarded by a pool shutdown
+	 * before running still count down, so wait() cannot hang on
+	 * them.
+	 *
+	 * A TaskGroup is as cheap as one shared allocation; create
+	 * them freely per request or per scope. The destructor
+	 * waits for the group like the pool destructor waits for
+	 * the pool.
+	 */
+	class TaskGroup {
+
+	    struct State {
+		std::mutex mutex;
+		std::condition_variable drained;
+		std::size_t pending;
+		std::exception_ptr pending_exception;
+		State() : pending(0) { }
+	    };
+
+	    /**
+	     * Task wrapper counting down the group's pending
+	     * counter exactly once, whether the payload ran,
+	     * threw, or was discarded at shutdown without running.
+	     */
+	    template<class Function>
+	    class GroupTask {
+
+		Function f;
+		std::shared_ptr<State> state;
+
+		static void finish(State& s) {
+		    std::lock_guard<std::mutex> lock(s.mutex);
+		    if (--s.pending == 0)
+			s.drained.notify_all();
+		}
+
+	    public:
+
+		GroupTask(Function&& f, std::shared_ptr<State> s)
+		    : f(std::move(f)), state(std::move(s)) { }
+		GroupTask(Function& f, std::shared_ptr<State> s)
+		    : f(f), state(std::move(s)) { }
+		GroupTask(GroupTask&& x)
+		    : f(std::move(x.f)), state(std::move(x.state)) { }
+
+		void operator()() {
+		    std::shared_ptr<State> s = std::move(state);
+		    try {
+			f();
+		    } catch (...) {
+			std::lock_guard<std::mutex> lock(s->mutex);
+			if (!s->pending_exception)
+			    s->pending_exception = std::current_exception();
+		    }
+		    finish(*s);
+		}
+
+		~GroupTask() { // Task was discarded without running
+		    if (state)
+			finish(*state);
+		}
+	    };
+
+	    VirtualThreadPoolInterface& pool;
+	    std::shared_ptr<State> state;
+
+	    TaskGroup(const TaskGroup&) = delete;
+	    TaskGroup& operator=(const TaskGroup&) = delete;
+
+	public:
+
+	    explicit TaskGroup(VirtualThreadPoolInterface& pool)
+		: pool(pool), state(new State) { }
+
+	    /**
+	     * Run a void function as a member of this group.
+	     */
+	    template<class Function>
+	    void run(Function&& f) {
+		run(Priority::normal, std::forward<Function>(f));
+	    }
+
+	    /**
+	     * Run a void function as a member of this group, in a
+	     * specific priority lane.
+	     */
+	    template<class Function>
+	    void run(Priority priority, Function&& f) {
+		typedef typename std::remove_reference<Function>::type function_type;
+		{
+		    std::lock_guard<std::mutex> lock(state->mutex);
+		    ++state->pending;
+		}
+		pool.run(priority,
+			 SmallTask(GroupTask<function_type>(std::forward<Function>(f),
+							    state)));
+	    }
+
+	    /**
+	     * Wait until all tasks of this group have finished.
+	     *
+	     * Tasks of other groups and ungrouped tasks on the same
+	     * pool are not waited for. Rethrows the first exception
+	     * a task of this group has encountered.
+	     *
+	     * Does not help the pool out: the caller really
+	     * blocks. Waiting from inside a pool task of the same
+	     * pool can therefore deadlock when no other worker is
+	     * free.
+	     */
+	    void wait() {
+		std::unique_lock<std::mutex> lock(state->mutex);
+		while (state->pending)
+		    state->drained.wait(lock);
+		if (state->pending_exception) {
+		    std::exception_ptr e = std::move(state->pending_exception);
+		    state->pending_exception = nullptr;
+		    std::rethrow_exception(std::move(e));
+		}
+	    }
+
+	    /**
+	     * Wait for the group like the pool destructor waits for
+	     * the pool. Can throw the group's pending exception,
+	     * unless wait() has been called before the destructor.
+	     */
+	    ~TaskGroup() {
+		if (std::uncaught_exception()) {
+		    try {
+			wait();
+		    } catch (...) {
+		    }
+		} else {
+		    wait();
+		}
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_TASK_GROUP_H)
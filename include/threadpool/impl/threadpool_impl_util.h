@@ -10,9 +10,17 @@
 #ifndef THREADPOOL_IMPL_UTIL_H
 #define THREADPOOL_IMPL_UTIL_H
 
+#include <cstddef>
 #include <type_traits>	    // For std::remove_reference()
 #include <iterator>
 #include <utility>	    // For std::move(), std::forward()
+#include <vector>
+#include <functional>
+
+#ifdef __linux__
+#   include <pthread.h>
+#   include <sched.h>
+#endif
 
 namespace ThreadPoolImpl {
 
@@ -22,6 +30,161 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * Pin the calling thread to a set of CPUs.
+	 *
+	 * Only implemented for Linux; a no-op elsewhere.
+	 */
+	inline void pin_current_thread_to_cpus(const std::vector<unsigned int>& cpus) {
+#ifdef __linux__
+	    if (cpus.empty())
+		return;
+	    cpu_set_t set;
+	    CPU_ZERO(&set);
+	    for (unsigned int c: cpus)
+		if (c < CPU_SETSIZE)
+		    CPU_SET(c, &set);
+	    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	    (void) cpus;
+#endif
+	}
+
+
+
+
+
+	/**
+	 * Assumed size of the destructive interference range: two
+	 * objects further apart than this do not false-share a cache
+	 * line. C++11 has no
+	 * std::hardware_destructive_interference_size; 64 bytes is
+	 * right for current x86 and most ARM implementations.
+	 */
+	const std::size_t cache_line_size = 64;
+
+
+
+
+
+	/**
+	 * Processor hint for the body of a spin-wait loop.
+	 *
+	 * Tells the CPU that we are busy-waiting, so it can relax
+	 * the pipeline and yield resources to the sibling
+	 * hyperthread. A no-op on architectures without such an
+	 * instruction.
+	 */
+	inline void cpu_relax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	    __builtin_ia32_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+	    __asm__ __volatile__("yield");
+#endif
+	}
+
+
+
+
+
+	/**
+	 * Priority lane of a task.
+	 *
+	 * The queue keeps one ring per lane behind the same locks.
+	 * Workers drain the lanes in priority order, with a
+	 * starvation guard that periodically services the lowest
+	 * nonempty lane, so background work still progresses under a
+	 * steady stream of high-priority tasks.
+	 */
+	enum class Priority {
+	    high = 0,
+	    normal = 1,
+	    low = 2
+	};
+
+	/** Number of priority lanes. */
+	const unsigned int priority_count = 3;
+
+
+
+
+
+	/**
+	 * Options for the worker threads of a pool.
+	 *
+	 * Passed through the pool constructors down to
+	 * GenericThreadPoolImpl, which applies them on each worker
+	 * thread right after it starts.
+	 */
+	struct ThreadOptions {
+
+	    /**
+	     * The CPUs the workers are pinned to. An empty set (the
+	     * default) leaves the workers unpinned. Pinning is only
+	     * implemented for Linux.
+	     */
+	    std::vector<unsigned int> cpus;
+
+	    /**
+	     * Callback invoked on each worker thread before it
+	     * starts taking tasks, with the worker index (0 ..
+	     * thread_count-1) as argument. Useful for naming,
+	     * priorities or custom affinity. An exception thrown
+	     * here shuts the pool down like a failing task.
+	     */
+	    std::function<void(unsigned int)> at_thread_start;
+	};
+
+
+
+
+
+	/**
+	 * Snapshot of the runtime statistics of a pool's queue.
+	 *
+	 * Returned by the statistics() member functions. The
+	 * counters are collected with relaxed atomics in the queue
+	 * when THREADPOOL_ENABLE_STATISTICS is set; with statistics
+	 * compiled out, only the instantaneous values (queue depth,
+	 * worker counts) are filled in and the counters stay zero.
+	 */
+	struct ThreadPoolStatistics {
+
+	    /** Number of execution time histogram buckets. */
+	    static const unsigned int histogram_buckets = 16;
+
+	    std::size_t queue_depth;	 /// Tasks currently waiting in the queue
+	    std::size_t max_queue_depth; /// High-water mark of the queue depth
+	    std::size_t queue_capacity;	 /// Depth at which put() blocks
+	    unsigned int total_workers;	 /// Threads currently inside the work loop
+	    unsigned int idle_workers;	 /// Threads currently waiting for tasks
+
+	    unsigned long long tasks_executed; /// Tasks run to completion
+	    unsigned long long wakeups;	       /// Worker wakeups signaled by put()
+	    unsigned long long idle_time_us;   /// Total worker wait time, microseconds
+
+	    /**
+	     * Histogram of per-task execution times. Bucket k counts
+	     * the tasks that took less than 2^k microseconds and did
+	     * not fall into an earlier bucket; the last bucket also
+	     * takes everything slower.
+	     */
+	    unsigned long long execution_time_histogram[histogram_buckets];
+
+	    ThreadPoolStatistics()
+		: queue_depth(0), max_queue_depth(0), queue_capacity(0),
+		  total_workers(0), idle_workers(0),
+		  tasks_executed(0), wakeups(0), idle_time_us(0)
+	    {
+		for (unsigned int i = 0; i != histogram_buckets; ++i)
+		    execution_time_histogram[i] = 0;
+	    }
+	};
+
+
+
+
+
 #ifndef __ICC
 
 #   define THREADPOOL_IMPL_EXPRESSION_CHECKER(name, expression) \
@@ -68,6 +231,8 @@ namespace ThreadPoolImpl {
 	    typename Base::value_type operator*() const { return i; }
 	    IntegralIterator& operator++() { ++i; return *this; }
 	    IntegralIterator operator++(int) { return IntegralIterator(i++); }
+	    IntegralIterator& operator--() { --i; return *this; }
+	    IntegralIterator operator--(int) { return IntegralIterator(i--); }
 	    template<class T> IntegralIterator& operator+=(const T& t) { i += t; return *this; }
 	    template<class T> IntegralIterator& operator-=(const T& t) { i += t; return *this; }
 	    IntegralIterator operator+(const I& t) const { return IntegralIterator(i + t); }
@@ -84,6 +249,84 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * A rectangular index range with a tile shape.
+	 *
+	 * Describes a rows × cols index space for the two-dimensional
+	 * overload of the parallel algorithms. The tile shape can be
+	 * specified to match the cache blocking of the kernel; a value
+	 * of 0 lets the algorithm derive a tile shape from its maxpart
+	 * parameter, splitting both dimensions evenly.
+	 *
+	 * @tparam T
+	 *		The integral type of the indices.
+	 */
+	template<class T>
+	class Range2D {
+
+	    T row_first_, row_last_;
+	    T col_first_, col_last_;
+	    std::size_t tile_rows_, tile_cols_;
+
+	public:
+
+	    typedef T value_type;
+
+	    /**
+	     * @param row_first
+	     *			The first row index.
+	     *
+	     * @param row_last
+	     *			One past the last row index.
+	     *
+	     * @param col_first
+	     *			The first column index.
+	     *
+	     * @param col_last
+	     *			One past the last column index.
+	     *
+	     * @param tile_rows
+	     *			The number of rows in a tile, 0 to let
+	     *			the algorithm choose.
+	     *
+	     * @param tile_cols
+	     *			The number of columns in a tile, 0 to
+	     *			let the algorithm choose.
+	     */
+	    Range2D(T row_first, T row_last, T col_first, T col_last,
+		    std::size_t tile_rows = 0, std::size_t tile_cols = 0)
+		: row_first_(row_first), row_last_(row_last),
+		  col_first_(col_first), col_last_(col_last),
+		  tile_rows_(tile_rows), tile_cols_(tile_cols)
+	    { }
+
+	    T row_first() const { return row_first_; }
+	    T row_last() const { return row_last_; }
+	    T col_first() const { return col_first_; }
+	    T col_last() const { return col_last_; }
+
+	    /// The number of rows, 0 for reversed bounds.
+	    std::size_t rows() const {
+		return (row_first_ < row_last_)
+		    ? static_cast<std::size_t>(row_last_ - row_first_) : 0;
+	    }
+
+	    /// The number of columns, 0 for reversed bounds.
+	    std::size_t cols() const {
+		return (col_first_ < col_last_)
+		    ? static_cast<std::size_t>(col_last_ - col_first_) : 0;
+	    }
+
+	    /// The requested tile height, 0 if the algorithm chooses.
+	    std::size_t tile_rows() const { return tile_rows_; }
+
+	    /// The requested tile width, 0 if the algorithm chooses.
+	    std::size_t tile_cols() const { return tile_cols_; }
+	};
+
+
+
+
 
 	/**
 	 * Dereference a pointer or iterator.
@@ -205,6 +448,30 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * Detect iterators with a bulk pull() operation.
+	 *
+	 * Generator-style input iterators like FunctionInputIterator
+	 * can hand out a whole block of values in one call, which lets
+	 * the input-iterator queues take one lock per block instead of
+	 * one lock per element. The trait is true when the iterator
+	 * has a member pull(std::vector<value_type>&, std::size_t).
+	 */
+	template<class Iterator>
+	struct has_bulk_pull {
+	    template<class X>
+	    static auto test(X* x)
+		-> decltype(x->pull(std::declval<std::vector<typename std::iterator_traits<X>::value_type>&>(),
+				    std::size_t(1)),
+			    std::true_type());
+	    template<class X>
+	    static std::false_type test(...);
+	    static const bool value = decltype(test<Iterator>(nullptr))::value;
+	};
+
+
+
+
 
 	/**
 	 * Wrap an arbitrary thing (maybe a reference)
@@ -0,0 +1,536 @@
+/** @file threadpool/impl/threadpool_impl_workstealing.h
+ *
+ * Threadpool for C++11, work-stealing queue for the homogenous pool
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_IMPL_THREADPOOL_IMPL_WORKSTEALING_H
+#define THREADPOOL_IMPL_THREADPOOL_IMPL_WORKSTEALING_H
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+
+#include "threadpool_generic.h"
+#include "threadpool_impl_util.h"
+#include "threadpool_impl_homogenous.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+
+
+
+
+	/*
+	  With one shared queue every dequeue crosses cores and
+	  bounces the cache line holding the queue pointers between
+	  all workers. The classic cure is work stealing: each worker
+	  owns a deque it pushes and pops at the bottom without
+	  contention, and idle workers steal single tasks from the
+	  top of a victim's deque. Tasks submitted from inside a
+	  worker (recursive submission) go to the submitter's own
+	  deque and are usually executed by the same thread, which
+	  keeps them cache-hot.
+
+	  The deque is the Chase-Lev deque in the C++11 formulation
+	  of Le, Pop, Cohen and Zappa Nardelli ("Correct and
+	  Efficient Work-Stealing for Weakly Ordered Memory
+	  Models"). The deque stores pointers; tasks are moved to
+	  the heap on submission because the racy buffer slots must
+	  hold a trivially copyable type.
+
+	  Submissions from threads that are not pool workers go to a
+	  mutex-protected central queue, which is also the fallback
+	  idle workers drain after stealing has failed.
+	*/
+
+	/**
+	 * Work-stealing queue for functions with signature void()
+	 *
+	 * Drop-in alternative to HQueue for HomogenousThreadPool,
+	 * selected through the pool's Queue template parameter.
+	 *
+	 * @tparam Function
+	 *		The function type to queue.
+	 */
+	template<class Function>
+	class WorkStealingHQueue : public GenericThreadPoolQueue {
+
+	    /**
+	     * Chase-Lev deque of Function pointers.
+	     *
+	     * push() and pop() may only be called by the owning
+	     * worker, steal() by anybody.
+	     */
+	    class Deque {
+
+		struct Array {
+		    std::size_t cap, mask;
+		    std::unique_ptr<std::atomic<Function*>[]> slots;
+		    Array(std::size_t c)
+			: cap(c), mask(c - 1),
+			  slots(new std::atomic<Function*>[c]) { }
+		    Function* get(std::size_t i) const {
+			return slots[i & mask].load(std::memory_order_relaxed);
+		    }
+		    void put(std::size_t i, Function* f) {
+			slots[i & mask].store(f, std::memory_order_relaxed);
+		    }
+		};
+
+		std::atomic<std::size_t> top;
+		std::atomic<std::size_t> bottom;
+		std::atomic<Array*> array;
+		/*
+		  Grown-out arrays can still be read by concurrent
+		  steal()ers, so they are retired here and freed only
+		  with the deque.
+		*/
+		std::vector<std::unique_ptr<Array>> retired;
+
+	    public:
+
+		Deque(std::size_t cap = 64)
+		    : top(0), bottom(0), array(new Array(cap)) { }
+
+		~Deque() { delete array.load(std::memory_order_relaxed); }
+
+		void push(Function* f) {
+		    std::size_t b = bottom.load(std::memory_order_relaxed);
+		    std::size_t t = top.load(std::memory_order_acquire);
+		    Array* a = array.load(std::memory_order_relaxed);
+		    if (b - t > a->mask) { // Full, grow
+			Array* na = new Array(2 * a->cap);
+			for (std::size_t i = t; i != b; ++i)
+			    na->put(i, a->get(i));
+			retired.emplace_back(a);
+			array.store(na, std::memory_order_release);
+			a = na;
+		    }
+		    a->put(b, f);
+		    std::atomic_thread_fence(std::memory_order_release);
+		    bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		Function* pop() {
+		    std::size_t b = bottom.load(std::memory_order_relaxed) - 1;
+		    Array* a = array.load(std::memory_order_relaxed);
+		    bottom.store(b, std::memory_order_relaxed);
+		    std::atomic_thread_fence(std::memory_order_seq_cst);
+		    std::size_t t = top.load(std::memory_order_relaxed);
+		    Function* f;
+		    if (static_cast<std::ptrdiff_t>(b - t) >= 0) {
+			f = a->get(b);
+			if (t == b) {
+			    // Single last element, race with steal()ers
+			    if (!top.compare_exchange_strong(t, t + 1,
+							     std::memory_order_seq_cst,
+							     std::memory_order_relaxed))
+				f = nullptr; // Lost the race
+			    bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		    } else {
+			f = nullptr; // Deque was empty
+			bottom.store(b + 1, std::memory_order_relaxed);
+		    }
+		    return f;
+		}
+
+		Function* steal() {
+		    std::size_t t = top.load(std::memory_order_acquire);
+		    std::atomic_thread_fence(std::memory_order_seq_cst);
+		    std::size_t b = bottom.load(std::memory_order_acquire);
+		    Function* f = nullptr;
+		    if (static_cast<std::ptrdiff_t>(b - t) > 0) {
+			Array* a = array.load(std::memory_order_acquire);
+			f = a->get(t);
+			if (!top.compare_exchange_strong(t, t + 1,
+							 std::memory_order_seq_cst,
+							 std::memory_order_relaxed))
+			    return nullptr; // Lost the race, try another victim
+		    }
+		    return f;
+		}
+
+		bool appears_empty() const {
+		    return static_cast<std::ptrdiff_t>(bottom.load(std::memory_order_relaxed)
+						       - top.load(std::memory_order_relaxed)) <= 0;
+		}
+	    };
+
+
+
+	    /**
+	     * The per-worker state: a deque and a claim flag.
+	     */
+	    struct WorkerSlot {
+		Deque deque;
+		std::atomic<bool> in_use;
+		WorkerSlot() : in_use(true) { }
+	    };
+
+	    /*
+	      Fixed-size table of worker slots so steal()ers can
+	      iterate over the victims without locking. Slots are
+	      claimed when a thread enters work() and released when
+	      it returns; surplus threads beyond the table size work
+	      off the central queue only.
+	    */
+	    static const unsigned int max_worker_slots = 64;
+	    std::atomic<WorkerSlot*> slot_table[max_worker_slots];
+	    std::atomic<unsigned int> slot_count;
+
+	    const std::size_t queue_size;	// Capacity bound of the central queue
+	    std::atomic<std::size_t> pending;	// Queued or running tasks
+	    std::atomic<unsigned int> idle_workers;
+	    std::atomic<bool> shutting_down;
+
+	    std::deque<Function*> central;	// Fallback queue for external submitters
+	    std::mutex central_mutex;
+
+	    // Slow path only: parking of idle workers and waiters
+	    std::mutex park_mutex;
+	    std::condition_variable waiting_workers;
+	    std::condition_variable waiters;
+
+	    /*
+	      The slot of the pool this thread is currently working
+	      for, so put() from inside a task can go to the local
+	      deque. Maintained with stack discipline by help() so
+	      nested pools keep working.
+	    */
+	    static thread_local WorkStealingHQueue* tl_owner;
+	    static thread_local WorkerSlot* tl_slot;
+
+
+
+	    WorkerSlot* acquire_slot() {
+		unsigned int n = slot_count.load(std::memory_order_acquire);
+		if (n > max_worker_slots)
+		    n = max_worker_slots;
+		for (unsigned int i = 0; i != n; ++i) {
+		    WorkerSlot* s = slot_table[i].load(std::memory_order_acquire);
+		    bool expected = false;
+		    if (s && s->in_use.compare_exchange_strong(expected, true,
+							       std::memory_order_acq_rel))
+			return s;
+		}
+		unsigned int i = slot_count.fetch_add(1, std::memory_order_acq_rel);
+		if (i >= max_worker_slots)
+		    return nullptr; // Table full, work off the central queue
+		WorkerSlot* s = new WorkerSlot;
+		slot_table[i].store(s, std::memory_order_release);
+		return s;
+	    }
+
+	    void release_slot(WorkerSlot* s) {
+		if (!s)
+		    return;
+		// Leftovers can exist after an exception or shutdown.
+		while (Function* f = s->deque.pop()) {
+		    if (shutting_down.load(std::memory_order_relaxed)) {
+			delete f;
+			release_pending();
+		    } else {
+			std::lock_guard<std::mutex> lock(central_mutex);
+			central.push_back(f);
+		    }
+		}
+		s->in_use.store(false, std::memory_order_release);
+	    }
+
+	    /**
+	     * Get the next runnable task: own deque first, then
+	     * steal, then the central queue.
+	     */
+	    Function* next_task(WorkerSlot* slot) {
+		Function* f;
+		if (slot && (f = slot->deque.pop()))
+		    return f;
+
+		unsigned int n = slot_count.load(std::memory_order_acquire);
+		if (n > max_worker_slots)
+		    n = max_worker_slots;
+		for (unsigned int round = 0; round != 2; ++round) {
+		    for (unsigned int i = 0; i != n; ++i) {
+			WorkerSlot* victim = slot_table[i].load(std::memory_order_acquire);
+			if (!victim || victim == slot)
+			    continue;
+			if ((f = victim->deque.steal()))
+			    return f;
+		    }
+		}
+
+		std::lock_guard<std::mutex> lock(central_mutex);
+		if (!central.empty()) {
+		    f = central.front();
+		    central.pop_front();
+		    return f;
+		}
+		return nullptr;
+	    }
+
+	    /**
+	     * Run a task, releasing the pending count and the task
+	     * memory even if it throws. Tasks are discarded instead
+	     * of run once the queue is shutting down.
+	     */
+	    void run_task(Function* f) {
+		std::unique_ptr<Function> p(f);
+		auto x1 = at_scope_exit([this](){ this->release_pending(); });
+		if (!shutting_down.load(std::memory_order_relaxed))
+		    (*p)();
+	    }
+
+	    /**
+	     * A task is done or discarded. Wake the waiters when the
+	     * last one finishes.
+	     */
+	    void release_pending() {
+		if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		    std::lock_guard<std::mutex> lock(park_mutex);
+		    waiters.notify_all();
+		}
+	    }
+
+	    bool anything_runnable() const {
+		unsigned int n = slot_count.load(std::memory_order_acquire);
+		if (n > max_worker_slots)
+		    n = max_worker_slots;
+		for (unsigned int i = 0; i != n; ++i) {
+		    WorkerSlot* s = slot_table[i].load(std::memory_order_acquire);
+		    if (s && !s->deque.appears_empty())
+			return true;
+		}
+		return !central.empty(); // Caller holds no lock; approximate
+	    }
+
+	    /**
+	     * Get tasks and execute them. If `return_if_idle`,
+	     * return as soon as nothing is runnable.
+	     */
+	    void help(bool return_if_idle) {
+		WorkerSlot* slot = acquire_slot();
+		WorkStealingHQueue* prev_owner = tl_owner;
+		WorkerSlot* prev_slot = tl_slot;
+		tl_owner = this;
+		tl_slot = slot;
+		auto x1 = at_scope_exit([this,slot,prev_owner,prev_slot](){
+			tl_owner = prev_owner;
+			tl_slot = prev_slot;
+			this->release_slot(slot);
+		    });
+
+		for (;;) {
+		    Function* f = next_task(slot);
+		    if (f) {
+			run_task(f);
+		    } else {
+			if (return_if_idle)
+			    return;
+
+			// Nothing runnable, wait for more tasks to be put()
+			std::unique_lock<std::mutex> lock(park_mutex);
+			/*
+			  Eventcount protocol: register as idle with a
+			  sequentially consistent increment BEFORE
+			  re-checking for runnable tasks, paired with
+			  the fence between push and idle_workers load
+			  in put(). Either the producer sees our
+			  registration and notifies, or we see its task
+			  and do not park; checking first would let a
+			  task slip between the check and the
+			  registration and leave it unserved while
+			  every worker sleeps.
+			*/
+			idle_workers.fetch_add(1);
+			while (!anything_runnable()
+			       && !shutting_down.load(std::memory_order_relaxed))
+			    waiting_workers.wait(lock);
+			idle_workers.fetch_sub(1, std::memory_order_relaxed);
+			if (shutting_down.load(std::memory_order_relaxed))
+			    return;
+		    }
+		}
+	    }
+
+	    /**
+	     * Help, and shut down if an exception escapes.
+	     */
+	    void try_help(bool return_if_idle) {
+		try {
+		    help(return_if_idle);
+		} catch (...) {
+		    shutdown();
+		    throw;
+		}
+	    }
+
+
+
+	public:
+
+	    WorkStealingHQueue(std::size_t queue_size, std::size_t /*maxpart*/)
+		: slot_count(0),
+		  queue_size(queue_size ? queue_size : 10000),
+		  pending(0),
+		  idle_workers(0),
+		  shutting_down(false)
+	    {
+		for (unsigned int i = 0; i != max_worker_slots; ++i)
+		    slot_table[i].store(nullptr, std::memory_order_relaxed);
+	    }
+
+	    /**
+	     * Get tasks and execute them. If `return_if_idle`, return
+	     * instead of idly waiting.
+	     */
+	    void work(bool return_if_idle) override {
+		help(return_if_idle);
+	    }
+
+	    /**
+	       Enqueue a task. Submissions from pool workers go to the
+	       submitter's own deque; all others to the central queue.
+	    */
+	    template<class C>
+	    void put(C&& c) {
+
+		if (shutting_down.load(std::memory_order_relaxed)) {
+		    Function fun(std::forward<C>(c)); // Run Function destructor
+		    return;
+		}
+
+		std::unique_ptr<Function> f(new Function(std::forward<C>(c)));
+		pending.fetch_add(1, std::memory_order_relaxed);
+
+		if (tl_owner == this && tl_slot) {
+		    tl_slot->deque.push(f.release());
+		} else {
+		    std::unique_lock<std::mutex> lock(central_mutex);
+		    while (central.size() >= queue_size) {
+			// No space in the queue. Help the workers to advance.
+			lock.unlock();
+			pending.fetch_sub(1, std::memory_order_relaxed);
+			try_help(true);
+			pending.fetch_add(1, std::memory_order_relaxed);
+			lock.lock();
+		    }
+		    central.push_back(f.release());
+		}
+
+		/*
+		  Eventcount pairing with the parking loop in help():
+		  the fence orders the deque or central push before the
+		  idle_workers load, and a parking worker registers
+		  with a sequentially consistent increment before it
+		  re-checks for runnable tasks. Either we see the
+		  registration and notify, or the worker sees our task
+		  and does not park; without the fence both loads could
+		  pass each other and the task would sit unserved until
+		  the next submission.
+		*/
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (idle_workers.load(std::memory_order_relaxed)) {
+		    std::lock_guard<std::mutex> lock(park_mutex);
+		    waiting_workers.notify_one();
+		}
+	    }
+
+	    void shutdown() override {
+		shutting_down.store(true, std::memory_order_relaxed);
+		{
+		    std::lock_guard<std::mutex> lock(central_mutex);
+		    while (!central.empty()) {
+			delete central.front();
+			central.pop_front();
+			release_pending();
+		    }
+		}
+		std::lock_guard<std::mutex> lock(park_mutex);
+		waiting_workers.notify_all();
+		waiters.notify_all();
+	    }
+
+	    void wait() {
+		if (std::uncaught_exception())
+		    shutdown();
+		std::exception_ptr e;
+		while (pending.load(std::memory_order_acquire) != 0) {
+		    try {
+			help(true);
+		    } catch (...) {
+			if (e == nullptr)
+			    e = std::current_exception();
+			shutdown();
+		    }
+		    std::unique_lock<std::mutex> lock(park_mutex);
+		    if (pending.load(std::memory_order_acquire) != 0
+			&& !anything_runnable())
+			waiters.wait(lock);
+		}
+		if (e != nullptr && !std::uncaught_exception())
+		    std::rethrow_exception(std::move(e));
+	    }
+
+	    virtual ~WorkStealingHQueue() {
+		shutting_down.store(true, std::memory_order_relaxed);
+		{
+		    std::lock_guard<std::mutex> lock(central_mutex);
+		    while (!central.empty()) {
+			delete central.front();
+			central.pop_front();
+		    }
+		}
+		unsigned int n = slot_count.load(std::memory_order_acquire);
+		if (n > max_worker_slots)
+		    n = max_worker_slots;
+		for (unsigned int i = 0; i != n; ++i) {
+		    WorkerSlot* s = slot_table[i].load(std::memory_order_acquire);
+		    while (Function* f = s ? s->deque.pop() : nullptr)
+			delete f;
+		    delete s;
+		}
+	    }
+	};
+
+	template<class Function>
+	thread_local WorkStealingHQueue<Function>*
+	WorkStealingHQueue<Function>::tl_owner = nullptr;
+
+	template<class Function>
+	thread_local typename WorkStealingHQueue<Function>::WorkerSlot*
+	WorkStealingHQueue<Function>::tl_slot = nullptr;
+
+
+
+
+
+	/**
+	 * A homogenous thread pool with work-stealing per-worker
+	 * deques.
+	 */
+	template<class Function>
+	using WorkStealingHomogenousThreadPool
+	    = HomogenousThreadPool<Function, WorkStealingHQueue<Function> >;
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+#endif // !defined(THREADPOOL_IMPL_THREADPOOL_IMPL_WORKSTEALING_H)
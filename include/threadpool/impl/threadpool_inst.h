@@ -22,8 +22,10 @@ namespace ThreadPoolImpl {
 	template<int I>
 	VirtualThreadPool<I>::VirtualThreadPool(int thread_count,
 						std::size_t queue_size,
-						std::size_t maxpart)
-	    : pimpl(new VirtualThreadPoolImpl<>(thread_count, queue_size, maxpart))
+						std::size_t maxpart,
+						ThreadOptions thread_options)
+	    : pimpl(new VirtualThreadPoolImpl<>(thread_count, queue_size, maxpart,
+						std::move(thread_options)))
 	{  }
 
 
@@ -37,6 +39,46 @@ namespace ThreadPoolImpl {
 	    pimpl->run(t);
 	}
 
+	template<int I>
+	void VirtualThreadPool<I>::run(SmallTask&& t) {
+	    pimpl->run(std::move(t));
+	}
+
+	template<int I>
+	void VirtualThreadPool<I>::run(Priority priority, SmallTask&& t) {
+	    pimpl->run(priority, std::move(t));
+	}
+
+	template<int I>
+	bool VirtualThreadPool<I>::try_run(SmallTask&& t) {
+	    return pimpl->try_run(std::move(t));
+	}
+
+	template<int I>
+	void VirtualThreadPool<I>::notify_when_space(std::function<void()> callback) {
+	    pimpl->notify_when_space(std::move(callback));
+	}
+
+	template<int I>
+	void VirtualThreadPool<I>::run_batch(std::vector<SmallTask>&& batch) {
+	    pimpl->run_batch(std::move(batch));
+	}
+
+	template<int I>
+	ThreadPoolStatistics VirtualThreadPool<I>::statistics() {
+	    return pimpl->statistics();
+	}
+
+	template<int I>
+	std::size_t VirtualThreadPool<I>::pending() {
+	    return pimpl->pending();
+	}
+
+	template<int I>
+	void VirtualThreadPool<I>::resize(std::size_t thread_count) {
+	    pimpl->resize(thread_count);
+	}
+
 	template<int I>
 	void VirtualThreadPool<I>::wait() {
 	    pimpl->wait();
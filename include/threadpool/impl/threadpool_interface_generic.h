@@ -10,6 +10,7 @@
 #ifndef THREADPOOL_INTERFACE_GENERIC_H
 #define THREADPOOL_INTERFACE_GENERIC_H
 
+#include <cstddef>
 #include <memory>
 
 #include "../threadpool_config.h"
@@ -46,6 +47,20 @@ namespace ThreadPoolImpl {
 	     * is processed.
 	     */
 	    virtual void shutdown() = 0;
+
+	    /**
+	     * Set the number of workers the queue should retain.
+	     *
+	     * Queues supporting idle-thread reclamation let surplus
+	     * workers return from work() once they have been idle
+	     * past a timeout while more than `target` workers attend
+	     * the queue. A target of 0 (the default) keeps every
+	     * worker until shutdown. The default implementation
+	     * ignores the target, for queues with a fixed worker
+	     * population.
+	     */
+	    virtual void set_worker_target(unsigned int) { }
+
 	    virtual ~GenericThreadPoolQueue() { };
 	};
 
@@ -110,6 +125,16 @@ namespace ThreadPoolImpl {
 	     */
 	    virtual void rethrow_exception() = 0;
 
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking lowers the worker target on the queue;
+	     * surplus workers retire after they have been idle past
+	     * the reclamation timeout.
+	     */
+	    virtual void resize(std::size_t thread_count) = 0;
+
 	    /**
 	     * Wait for all threads to finish and collect them.
 	     *
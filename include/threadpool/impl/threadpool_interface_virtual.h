@@ -15,9 +15,11 @@
 #include <utility>
 #include <type_traits>
 #include <future>
+#include <vector>
 
 #include "../threadpool_config.h"
 #include "threadpool_impl_util.h"
+#include "threadpool_impl_arena.h"
 
 namespace ThreadPoolImpl {
 
@@ -38,6 +40,21 @@ namespace ThreadPoolImpl {
 	class VirtualThreadPool_Task {
 	public:
 
+#if defined(THREADPOOL_USE_TASK_ARENA) && THREADPOOL_USE_TASK_ARENA
+	    /*
+	      Tasks are created on the submitting thread and freed
+	      with `delete this` on whatever worker ran them. Route
+	      their memory through the recycling arena so blocks are
+	      reused instead of bouncing through the global allocator.
+	    */
+	    static void* operator new(std::size_t size) {
+		return TaskArena::allocate(size);
+	    }
+	    static void operator delete(void* p) {
+		TaskArena::deallocate(p);
+	    }
+#endif
+
 	    /**
 	     * The payload, users function to be run.
 	     *
@@ -56,6 +73,174 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * Type-erased task with small-buffer optimization
+	 *
+	 * One queue slot of the virtual thread pool. Callables up to
+	 * `inline_size` bytes are stored directly in the slot, so
+	 * run()ning small closures does not touch the heap at
+	 * all. Larger callables and the classic
+	 * VirtualThreadPool_Task interface fall back to a heap
+	 * pointer.
+	 *
+	 * Copying is not supported so a heap task is not deleted
+	 * twice; moving leaves an empty task behind. Like the tasks
+	 * themselves, a SmallTask may be executed only once.
+	 */
+	class SmallTask {
+
+	    struct Ops {
+		void (*invoke)(SmallTask&);
+		void (*move_construct)(SmallTask&, SmallTask&);
+		void (*destroy)(SmallTask&);
+	    };
+
+	public:
+
+	    /** Closures up to this size are stored inline in the queue slot. */
+	    static const std::size_t inline_size = 48;
+
+	private:
+
+	    union Storage {
+		VirtualThreadPool_Task* task;
+		alignas(16) char buf[inline_size];
+	    };
+
+	    const Ops* ops;
+	    Storage storage;
+
+	    template<class F> F& payload() {
+		return reinterpret_cast<F&>(storage.buf);
+	    }
+
+	    /*
+	      Heap mode: storage.task points to a task that deletes
+	      itself when run. Unexecuted tasks (queue shutdown,
+	      exception from the payload) are deleted by the
+	      destructor.
+	    */
+	    static void task_invoke(SmallTask& t) {
+		(*t.storage.task)();
+		t.ops = nullptr;
+	    }
+	    static void task_move_construct(SmallTask& dst, SmallTask& src) {
+		dst.storage.task = src.storage.task;
+		src.ops = nullptr;
+	    }
+	    static void task_destroy(SmallTask& t) {
+		delete t.storage.task;
+	    }
+	    static const Ops* task_ops() {
+		static const Ops ops = {
+		    &SmallTask::task_invoke,
+		    &SmallTask::task_move_construct,
+		    &SmallTask::task_destroy
+		};
+		return &ops;
+	    }
+
+	    /*
+	      Inline mode: the callable lives in storage.buf.
+	    */
+	    template<class F> static void inline_invoke(SmallTask& t) {
+		F& f = t.payload<F>();
+		f();
+		f.~F();
+		t.ops = nullptr;
+	    }
+	    template<class F> static void inline_move_construct(SmallTask& dst, SmallTask& src) {
+		new (&dst.storage.buf) F(std::move(src.payload<F>()));
+		src.payload<F>().~F();
+		src.ops = nullptr;
+	    }
+	    template<class F> static void inline_destroy(SmallTask& t) {
+		t.payload<F>().~F();
+	    }
+	    template<class F> static const Ops* inline_ops() {
+		static const Ops ops = {
+		    &SmallTask::inline_invoke<F>,
+		    &SmallTask::inline_move_construct<F>,
+		    &SmallTask::inline_destroy<F>
+		};
+		return &ops;
+	    }
+
+	    /**
+	     * Fallback wrapper for callables too large for the
+	     * inline buffer.
+	     */
+	    template<class F>
+	    class WrappedFunction : public VirtualThreadPool_Task {
+		F f;
+	    public:
+		WrappedFunction(F&& f) : f(std::move(f)) { }
+		WrappedFunction(const F& f) : f(f) { }
+		virtual void operator()() override {
+		    f();
+		    delete this;
+		}
+	    };
+
+	    template<class F, class G>
+	    void construct(G&& g, std::true_type /*fits inline*/) {
+		new (&storage.buf) F(std::forward<G>(g));
+		ops = inline_ops<F>();
+	    }
+	    template<class F, class G>
+	    void construct(G&& g, std::false_type /*does not fit*/) {
+		storage.task = new WrappedFunction<F>(std::forward<G>(g));
+		ops = task_ops();
+	    }
+
+	    SmallTask(const SmallTask&) = delete;
+	    SmallTask& operator=(const SmallTask&) = delete;
+	    SmallTask& operator=(SmallTask&&) = delete;
+
+	public:
+
+	    SmallTask() : ops(nullptr) { }
+
+	    SmallTask(VirtualThreadPool_Task* t) : ops(task_ops()) {
+		storage.task = t;
+	    }
+
+	    SmallTask(std::unique_ptr<VirtualThreadPool_Task>&& t) : ops(task_ops()) {
+		storage.task = t.release();
+	    }
+
+	    template<class F,
+		     class = typename std::enable_if<
+			 !std::is_same<typename std::decay<F>::type, SmallTask>::value
+			 && !std::is_convertible<F, VirtualThreadPool_Task*>::value
+			 >::type>
+	    SmallTask(F&& f) {
+		typedef typename std::decay<F>::type function_type;
+		construct<function_type>(std::forward<F>(f),
+					 std::integral_constant<bool,
+					 sizeof(function_type) <= inline_size
+					 && alignof(function_type) <= 16>());
+	    }
+
+	    SmallTask(SmallTask&& x) : ops(x.ops) {
+		if (ops)
+		    ops->move_construct(*this, x);
+	    }
+
+	    void operator()() {
+		ops->invoke(*this);
+	    }
+
+	    ~SmallTask() {
+		if (ops)
+		    ops->destroy(*this);
+	    }
+	};
+
+
+
+
+
 	/**
 	 * Interface of virtual thread pool.
 	 *
@@ -74,6 +259,62 @@ namespace ThreadPoolImpl {
 
 	    virtual void run(std::unique_ptr<VirtualThreadPool_Task>&& c) = 0;
 	    virtual void run(VirtualThreadPool_Task* c) = 0;
+	    virtual void run(SmallTask&& c) = 0;
+
+	    /**
+	     * Run a task in a specific priority lane. High-priority
+	     * tasks overtake queued normal and low ones; a starvation
+	     * guard keeps the low lane moving.
+	     */
+	    virtual void run(Priority priority, SmallTask&& c) = 0;
+
+	    /**
+	     * Try to run a task without ever blocking or running
+	     * other tasks on the calling thread. Returns false and
+	     * discards the task when the queue is at capacity.
+	     */
+	    virtual bool try_run(SmallTask&& c) = 0;
+
+	    /**
+	     * Register a one-shot callback invoked as soon as the
+	     * queue has space for another task, so a non-blocking
+	     * submitter can apply backpressure upstream and resubmit
+	     * later. Invoked immediately when there is space right
+	     * now, otherwise later on a worker thread.
+	     */
+	    virtual void notify_when_space(std::function<void()> callback) = 0;
+
+	    /**
+	     * Run a batch of tasks, taking the queue lock only once
+	     * for the whole batch.
+	     */
+	    virtual void run_batch(std::vector<SmallTask>&& batch) = 0;
+
+	    /**
+	     * Take a snapshot of the pool's runtime statistics:
+	     * queue depth, worker utilization and task counters.
+	     * The counters stay zero when the library is compiled
+	     * with THREADPOOL_ENABLE_STATISTICS set to 0.
+	     */
+	    virtual ThreadPoolStatistics statistics() = 0;
+
+	    /**
+	     * Number of tasks submitted but not yet finished, whether
+	     * still queued or executing. A single atomic load, safe to
+	     * poll from monitoring threads without touching a mutex.
+	     */
+	    virtual std::size_t pending() = 0;
+
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking lets the surplus workers retire after they
+	     * have been idle past the idle timeout, and their
+	     * resources are reclaimed by the next resize() or
+	     * join().
+	     */
+	    virtual void resize(std::size_t thread_count) = 0;
 
 	    /**
 	     * Wait for all active tasks to finish.
@@ -143,27 +384,16 @@ namespace ThreadPoolImpl {
 
 	    /**
 	     * Wrap void functions in a task and run them without
-	     * exception handling.
+	     * exception handling. Small closures are stored inline
+	     * in the queue slot and do not touch the heap.
 	     */
 	    template<class Function>
 	    typename std::enable_if<is_callable<Function>::value
 				    && std::is_void<typename std::result_of<Function()>::type>::value,
 				    void
 				    >::type run(Function&& f) {
-	    
-		typedef typename std::remove_reference<Function>::type function_type;
 
-		class WrappedFunction : public Base::Task {
-		    Function f;
-		public:
-		    WrappedFunction(function_type&& f) : f(std::move(f)) { }
-		    virtual void operator()() override {
-			f();
-			delete this;
-		    }
-		};
-
-		Base::run(new WrappedFunction(std::forward<Function>(f)));
+		Base::run(SmallTask(std::forward<Function>(f)));
 	    }
 
 
@@ -196,11 +426,15 @@ namespace ThreadPoolImpl {
 		    }
 
 		    virtual void operator()() override {
+#if defined(THREADPOOL_NOEXCEPT_TASKS) && THREADPOOL_NOEXCEPT_TASKS
+			promise.set_value(f());
+#else
 			try {
 			    promise.set_value(f());
 			} catch (...) {
 			    promise.set_exception(std::current_exception());
 			}
+#endif
 			delete this;
 		    }
 
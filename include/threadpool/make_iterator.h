@@ -10,10 +10,12 @@
 #ifndef THREADPOOL_MAKE_ITERATOR_H
 #define THREADPOOL_MAKE_ITERATOR_H
 
+#include <cstddef>
 #include <iterator>
 #include <type_traits>
 #include <stdexcept> // for std::out_of_range
 #include <memory> // for std::shared_ptr
+#include <vector> // for the pull() buffer
 
 
 
@@ -198,6 +200,50 @@ namespace ThreadPoolImpl {
 		return !operator==(x);
 	    }
 
+	    /**
+	     * Pull up to `n` values in one call.
+	     *
+	     * Appends the values to `buffer` and returns the number of
+	     * values appended. A short count is returned only when the
+	     * input sequence ends. A value already generated by a
+	     * preceding comparison is delivered first.
+	     *
+	     * The parallel algorithms take one lock per element when
+	     * they read from an input iterator. With pull() they take
+	     * a whole block of values under one lock and process it
+	     * without locking, which matters when the generator
+	     * function is cheap; see has_bulk_pull.
+	     *
+	     * Only available when the generator returns by value; a
+	     * reference would be invalidated by the next call.
+	     */
+	    template<class V = typename Base::value_type,
+		     class = typename std::enable_if<!std::is_reference<V>::value>::type>
+	    std::size_t pull(std::vector<V>& buffer, std::size_t n)
+	    {
+		std::size_t count = 0;
+
+		if (v == nullptr)
+		    return count; // The end iterator delivers nothing
+
+		if (v->value_valid && count != n) {
+		    buffer.push_back(v->value.move());
+		    v->value_valid = false;
+		    ++count;
+		}
+
+		while (!v->last && count != n) {
+		    try {
+			buffer.push_back((*v->fun)());
+			++count;
+		    } catch (std::out_of_range&) {
+			v->last = true;
+		    }
+		}
+
+		return count;
+	    }
+
 	};
 
 
@@ -232,6 +278,41 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * An output iterator that emplace-constructs assigned
+	 * values at the back of a container.
+	 *
+	 * Unlike std::back_insert_iterator, which passes the
+	 * assigned value to push_back() and thereby copy- or
+	 * move-constructs the element, the value is forwarded to
+	 * emplace_back(), so the element is constructed exactly once
+	 * and directly in its final slot. Combined with a single
+	 * reserve() up front this makes collecting large
+	 * non-trivially-copyable results growth- and copy-free;
+	 * parallel::transform_into() packages exactly that.
+	 *
+	 * The parallel transform algorithms write their output in
+	 * input order and one thread at a time, so the container
+	 * needs no extra locking even in multithreaded use.
+	 */
+	template<class Container>
+	class EmplaceOutputIterator
+	    : public std::iterator<std::output_iterator_tag, void, void, void, void> {
+
+	    Container* container;
+
+	public:
+	    explicit EmplaceOutputIterator(Container& container) : container(&container) { }
+	    EmplaceOutputIterator& operator++() { return *this; }
+	    EmplaceOutputIterator& operator++(int) { return *this; }
+	    EmplaceOutputIterator& operator*() { return *this; }
+	    template<class Arg> void operator=(Arg&& arg) {
+		container->emplace_back(std::forward<Arg>(arg));
+	    }
+	};
+
+
+
 	/**
 	 * An output iterator made from a function
 	 *
@@ -305,6 +386,25 @@ namespace threadpool {
     make_function_output_iterator(Function&& fun) {
 	return ThreadPoolImpl::impl::FunctionOutputIterator<Function>(std::forward<Function>(fun));
     }
+
+    /**
+     * Create an output iterator that emplace-constructs assigned
+     * values at the back of a container.
+     *
+     * @param container
+     *		The container receiving the values. It must outlive
+     *		the iterator. Values are forwarded to emplace_back(),
+     *		so each element is constructed exactly once, directly
+     *		in its final slot.
+     *
+     * @returns
+     *		The output iterator.
+     */
+    template<class Container>
+    ThreadPoolImpl::impl::EmplaceOutputIterator<Container>
+    make_emplace_iterator(Container& container) {
+	return ThreadPoolImpl::impl::EmplaceOutputIterator<Container>(container);
+    }
  
 } // End of namespace threadpool
 
@@ -14,9 +14,12 @@
 #include <type_traits>
 #include <iterator>
 #include <mutex>
+#include <vector>
 
 #include "impl/threadpool_generic.h"
 #include "impl/threadpool_impl_util.h"
+#include "impl/threadpool_impl_shared.h"
+#include "impl/threadpool_impl_drive.h"
 #include "singlethreaded/parallel_for_each.h"
 
 namespace ThreadPoolImpl {
@@ -64,13 +67,26 @@ namespace ThreadPoolImpl {
 	    ForEachThreadPoolImpl_Queue(Iterator& first,
 					const Last& last,
 					Function& fun,
-					std::size_t /*ignored*/ = 0)
+					std::size_t /*ignored*/ = 0,
+					std::size_t /*ignored*/ = 1)
 		: current(first),
 		  last(last),
 		  fun(fun)
 	    { }
 
 	    void work(bool /*ignored*/) override
+	    {
+		work_impl(std::integral_constant<bool, has_bulk_pull<Iterator>::value>());
+	    }
+
+	private:
+
+	    static const std::size_t pull_chunk_size = 16; // Elements taken per input lock
+
+	    /**
+	     * General case: one lock per element.
+	     */
+	    void work_impl(std::false_type)
 	    {
 		const Last& l(last);
 		for (;;) {
@@ -84,6 +100,29 @@ namespace ThreadPoolImpl {
 		}
 	    }
 
+	    /**
+	     * Bulk-pullable generator iterators: a block of values is
+	     * fetched under one lock and processed without any lock.
+	     */
+	    void work_impl(std::true_type)
+	    {
+		const Last& l(last);
+		std::vector<typename std::iterator_traits<Iterator>::value_type> buffer;
+		for (;;) {
+		    buffer.clear();
+		    {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (current == l)
+			    break;
+			current.pull(buffer, pull_chunk_size);
+		    }
+		    for (auto& v: buffer)
+			fun(std::move(v));
+		}
+	    }
+
+	public:
+
 	    /**
 	     * Shut the queue down, stop returning values
 	     */
@@ -130,6 +169,7 @@ namespace ThreadPoolImpl {
 	    typedef  ForEachThreadPoolImpl_Queue<Iterator, Last, Function, false> Base;
 
 	    const std::size_t maxpart;
+	    const typename std::iterator_traits<Iterator>::difference_type min_chunk;
 	    typename std::iterator_traits<Iterator>::difference_type remaining;
 
 
@@ -138,9 +178,11 @@ namespace ThreadPoolImpl {
 	    ForEachThreadPoolImpl_Queue(Iterator& first,
 					const Last& last,
 					Function& fun,
-					std::size_t maxpart)
+					std::size_t maxpart,
+					std::size_t min_chunk = 1)
 		: Base(first, last, fun),
 		  maxpart(maxpart),
+		  min_chunk(min_chunk ? min_chunk : 1),
 		  remaining(std::distance(first, last))
 	    { }
 
@@ -155,8 +197,18 @@ namespace ThreadPoolImpl {
 			if ((c = this->current) == last)
 			    break;
 
+			/*
+			  Guided self-scheduling: the stride shrinks
+			  geometrically with the remaining input, but
+			  never below min_chunk, so the tail does not
+			  degenerate into single-element grabs.
+			*/
 			typename std::iterator_traits<Iterator>::difference_type stride =
 			    (maxpart == 0) ? 1 : remaining / maxpart;
+			if (stride < min_chunk)
+			    stride = min_chunk;
+			if (stride > remaining)
+			    stride = remaining;
 			if (stride <= 0)
 			    stride = 1;
 
@@ -202,12 +254,16 @@ namespace ThreadPoolImpl {
 	template<class Iterator, class Last, class Function>
 	class ForEachThreadPoolImpl {
 
+	public:
+
 	    typedef ForEachThreadPoolImpl_Queue<Iterator, Last, Function,
 						std::is_base_of<std::forward_iterator_tag,
 								typename std::iterator_traits<Iterator>::iterator_category
 								>::value
 						> Queue;
 
+	private:
+
 	    Queue queue;
 	    GenericThreadPool pool;
 
@@ -256,8 +312,9 @@ namespace ThreadPoolImpl {
 	    ForEachThreadPoolImpl(Iterator& first, const Last& last,
 				  Function& fun,
 				  int thread_count,
-				  std::size_t maxpart)
-		: queue(first, last, fun, maxpart),
+				  std::size_t maxpart,
+				  std::size_t min_chunk = 1)
+		: queue(first, last, fun, maxpart, min_chunk),
 		  pool(queue, thread_count)
 	    { }
 
@@ -280,6 +337,405 @@ namespace ThreadPoolImpl {
 
 
 
+
+
+	/*
+	  Calling the function once per element defeats
+	  auto-vectorization: the compiler can not SIMD across opaque
+	  per-element callbacks. When the function is written as a
+	  range kernel instead, hand it the whole chunk and let it
+	  loop -- the chunks are exactly the ones the guided
+	  scheduling above would have produced anyway.
+	*/
+
+	/**
+	 * Queue handing each worker a contiguous sub-range.
+	 *
+	 * Instead of `fun(element)` per element, calls
+	 * `fun(begin, end)` once per chunk, so the function can run
+	 * a vectorizable loop over the range. Requires random access
+	 * iterators.
+	 *
+	 * @relates ForEachBlockedThreadPoolImpl
+	 */
+	template<class Iterator, class Last, class Function>
+	class ForEachBlockedThreadPoolImpl_Queue : public GenericThreadPoolQueue {
+
+	    Iterator& current;
+	    const Last& last;
+	    Function& fun;
+	    std::mutex mutex; // Make sure threads do not access concurrently
+	    const std::size_t maxpart;
+	    const typename std::iterator_traits<Iterator>::difference_type min_chunk;
+	    typename std::iterator_traits<Iterator>::difference_type remaining;
+
+	public:
+
+	    ForEachBlockedThreadPoolImpl_Queue(Iterator& first,
+					       const Last& last,
+					       Function& fun,
+					       std::size_t maxpart,
+					       std::size_t min_chunk = 1)
+		: current(first),
+		  last(last),
+		  fun(fun),
+		  maxpart(maxpart),
+		  min_chunk(min_chunk ? min_chunk : 1),
+		  remaining(std::distance(first, last))
+	    { }
+
+	    void work(bool /*ignored*/) override
+	    {
+		const Last& last = this->last; // Does never change
+		for (;;) {
+		    Iterator c, l;
+		    {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if ((c = current) == last)
+			    break;
+
+			/*
+			  Same guided self-scheduling as the
+			  per-element queue above.
+			*/
+			typename std::iterator_traits<Iterator>::difference_type stride =
+			    (maxpart == 0) ? 1 : remaining / maxpart;
+			if (stride < min_chunk)
+			    stride = min_chunk;
+			if (stride > remaining)
+			    stride = remaining;
+			if (stride <= 0)
+			    stride = 1;
+
+			l = c;
+			std::advance(l, stride);
+			current = l;
+			remaining -= stride;
+		    }
+
+		    fun(c, l); // One call for the whole chunk
+		}
+	    }
+
+	    /**
+	     * Shut the queue down, stop returning values
+	     */
+	    void shutdown() override
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		current = last;
+	    }
+	};
+
+
+
+
+
+	/**
+	 * A thread pool processing a range in contiguous chunks.
+	 *
+	 * @tparam Iterator
+	 *		The iterator type to be used to traverse the
+	 *		container. Must be a random access iterator.
+	 *
+	 * @tparam Last
+	 *		The iterator type for the last element.
+	 *
+	 * @tparam Function
+	 *		The function type to execute. Must be callable
+	 *		with two iterators as a half-open range,
+	 *		e.g. as void(Iterator begin, Iterator end).
+	 */
+	template<class Iterator, class Last, class Function>
+	class ForEachBlockedThreadPoolImpl {
+
+	public:
+
+	    typedef ForEachBlockedThreadPoolImpl_Queue<Iterator, Last, Function> Queue;
+
+	private:
+
+	    Queue queue;
+	    GenericThreadPool pool;
+
+	public:
+
+	    ForEachBlockedThreadPoolImpl(Iterator& first, const Last& last,
+					 Function& fun,
+					 int thread_count,
+					 std::size_t maxpart,
+					 std::size_t min_chunk = 1)
+		: queue(first, last, fun, maxpart, min_chunk),
+		  pool(queue, thread_count)
+	    { }
+
+	    /**
+	     * Collect threads, throw any pending exceptions.
+	     */
+	    void join()
+	    {
+		pool.join();
+	    }
+
+	};
+
+
+
+
+	/*
+	  A kernel over a rows × cols index space loses tile locality
+	  when the indices are flattened into one dimension: each chunk
+	  strides across full rows and misses in L2. The tiled queue
+	  hands out rectangular tiles of the 2D range instead, so the
+	  working set of one call is a tile that fits the cache.
+	*/
+
+	/**
+	 * Queue handing each worker a rectangular tile of a 2D range.
+	 *
+	 * Calls `fun(row_begin, row_end, col_begin, col_end)` once per
+	 * tile. The tiles are fixed up front, not guided: a cache
+	 * blocking only works with a fixed tile shape. When the range
+	 * does not specify one, both dimensions are split evenly into
+	 * about maxpart tiles.
+	 *
+	 * @relates ForEachTiledThreadPoolImpl
+	 */
+	template<class T, class Function>
+	class ForEachTiledThreadPoolImpl_Queue : public GenericThreadPoolQueue {
+
+	    const Range2D<T>& range;
+	    Function& fun;
+	    std::mutex mutex; // Make sure threads do not access concurrently
+	    std::size_t tile_rows, tile_cols;
+	    std::size_t grid_rows, grid_cols; // The range in units of tiles
+	    std::size_t next_tile;
+	    std::size_t tile_count;
+
+	    /**
+	     * Split `n` into about `parts` even pieces, at least 1 wide.
+	     */
+	    static std::size_t split(std::size_t n, std::size_t parts)
+	    {
+		if (parts == 0)
+		    parts = 1;
+		std::size_t width = (n + parts - 1) / parts;
+		return width ? width : 1;
+	    }
+
+	public:
+
+	    ForEachTiledThreadPoolImpl_Queue(const Range2D<T>& range,
+					     Function& fun,
+					     std::size_t maxpart)
+		: range(range),
+		  fun(fun),
+		  tile_rows(range.tile_rows()),
+		  tile_cols(range.tile_cols()),
+		  next_tile(0)
+	    {
+		/*
+		  Default tile shape: a square-ish grid with about
+		  maxpart tiles, splitting rows and columns evenly.
+		*/
+		if (tile_rows == 0 || tile_cols == 0) {
+		    std::size_t g = 1;
+		    while (g * g < maxpart)
+			++g;
+		    if (tile_rows == 0)
+			tile_rows = split(range.rows(), g);
+		    if (tile_cols == 0)
+			tile_cols = split(range.cols(), g);
+		}
+		grid_rows = (range.rows() + tile_rows - 1) / tile_rows;
+		grid_cols = (range.cols() + tile_cols - 1) / tile_cols;
+		tile_count = grid_rows * grid_cols;
+	    }
+
+	    void work(bool /*ignored*/) override
+	    {
+		for (;;) {
+		    std::size_t t;
+		    {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (next_tile == tile_count)
+			    break;
+			t = next_tile++;
+		    }
+
+		    T row_begin = range.row_first()
+			+ static_cast<T>((t / grid_cols) * tile_rows);
+		    T row_end = row_begin + static_cast<T>(tile_rows);
+		    if (row_end > range.row_last())
+			row_end = range.row_last();
+
+		    T col_begin = range.col_first()
+			+ static_cast<T>((t % grid_cols) * tile_cols);
+		    T col_end = col_begin + static_cast<T>(tile_cols);
+		    if (col_end > range.col_last())
+			col_end = range.col_last();
+
+		    fun(row_begin, row_end, col_begin, col_end);
+		}
+	    }
+
+	    /**
+	     * Shut the queue down, stop returning tiles
+	     */
+	    void shutdown() override
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		next_tile = tile_count;
+	    }
+	};
+
+
+
+
+	/**
+	 * A thread pool processing a 2D range in rectangular tiles.
+	 *
+	 * @tparam T
+	 *		The integral index type of the range.
+	 *
+	 * @tparam Function
+	 *		The function type to execute. Must be callable
+	 *		with the tile bounds, as void(T row_begin,
+	 *		T row_end, T col_begin, T col_end).
+	 */
+	template<class T, class Function>
+	class ForEachTiledThreadPoolImpl {
+
+	public:
+
+	    typedef ForEachTiledThreadPoolImpl_Queue<T, Function> Queue;
+
+	private:
+
+	    Queue queue;
+	    GenericThreadPool pool;
+
+	public:
+
+	    ForEachTiledThreadPoolImpl(const Range2D<T>& range,
+				       Function& fun,
+				       int thread_count,
+				       std::size_t maxpart)
+		: queue(range, fun, maxpart),
+		  pool(queue, thread_count)
+	    { }
+
+	    /**
+	     * Collect threads, throw any pending exceptions.
+	     */
+	    void join()
+	    {
+		pool.join();
+	    }
+
+	};
+
+
+
+
+
+	/*
+	  Driver dispatch: with random access iterators the queue work
+	  of for_each() and for_each_blocked() reduces to index chunks
+	  over a counted range, which the type-erased ParallelDrive
+	  runs with the queue and pool machinery compiled once -- into
+	  the library, in library configuration. Other iterator
+	  categories keep the template queues. Tag dispatch on the
+	  iterator category selects the variant at compile time.
+	*/
+
+	template<class Iterator, class Last, class Function>
+	void run_parallel_for_each(Iterator first, const Last& last, Function& fun,
+				   int thread_count, std::size_t maxpart,
+				   std::size_t min_chunk,
+				   std::random_access_iterator_tag)
+	{
+	    typedef typename std::iterator_traits<Iterator>::difference_type difference_type;
+	    const std::size_t count =
+		static_cast<std::size_t>(std::distance(first, last));
+	    const Iterator base = first;
+
+	    ParallelDrive::drive_blocked(count, thread_count, maxpart, min_chunk,
+		[&base, &fun](std::size_t lo, std::size_t hi) {
+		    Iterator c = base + static_cast<difference_type>(lo);
+		    const Iterator l = base + static_cast<difference_type>(hi);
+		    while (c != l) {
+			fun(*c);
+			++c;
+		    }
+		});
+	}
+
+	template<class Iterator, class Last, class Function>
+	void run_parallel_for_each(Iterator first, const Last& last, Function& fun,
+				   int thread_count, std::size_t maxpart,
+				   std::size_t min_chunk,
+				   std::input_iterator_tag)
+	{
+	    if (thread_count == -1) {
+		typename ForEachThreadPoolImpl<Iterator, Last, Function
+					       >::Queue queue(first, last, fun,
+							      maxpart, min_chunk);
+		run_on_shared_pool(queue,
+				   GenericThreadPool::determine_thread_count(thread_count));
+	    } else {
+		ForEachThreadPoolImpl<Iterator, Last, Function
+				      >(first, last, fun, thread_count,
+					maxpart, min_chunk);
+	    }
+	}
+
+	template<class Iterator, class Last, class Function>
+	void run_parallel_for_each_blocked(Iterator first, const Last& last, Function& fun,
+					   int thread_count, std::size_t maxpart,
+					   std::size_t min_chunk,
+					   std::random_access_iterator_tag)
+	{
+	    typedef typename std::iterator_traits<Iterator>::difference_type difference_type;
+	    const std::size_t count =
+		static_cast<std::size_t>(std::distance(first, last));
+	    const Iterator base = first;
+
+	    ParallelDrive::drive_blocked(count, thread_count, maxpart, min_chunk,
+		[&base, &fun](std::size_t lo, std::size_t hi) {
+		    fun(base + static_cast<difference_type>(lo),
+			base + static_cast<difference_type>(hi));
+		});
+	}
+
+	template<class Iterator, class Last, class Function>
+	void run_parallel_for_each_blocked(Iterator first, const Last& last, Function& fun,
+					   int thread_count, std::size_t maxpart,
+					   std::size_t min_chunk,
+					   std::input_iterator_tag)
+	{
+	    if (thread_count == -1) {
+		typename ForEachBlockedThreadPoolImpl<Iterator, Last, Function
+						      >::Queue queue(first, last, fun,
+								     maxpart, min_chunk);
+		run_on_shared_pool(queue,
+				   GenericThreadPool::determine_thread_count(thread_count));
+	    } else {
+		ForEachBlockedThreadPoolImpl<Iterator, Last, Function
+					     >(first, last, fun, thread_count,
+					       maxpart, min_chunk);
+	    }
+	}
+
+
+
+
+
+
+
+
+
     } // End of namespace impl
 
 } // End of namespace ThreadPoolImpl
@@ -311,7 +767,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -330,9 +789,19 @@ namespace threadpool {
 	 *		system determine a value, which is three times
 	 *		the number of threads. A value of 0 enforces
 	 *		single-object processing.
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take. The chunks shrink geometrically from
+	 *		remaining/maxpart toward this floor (guided
+	 *		self-scheduling), which reduces contention on
+	 *		the queue lock at the tail when element costs
+	 *		vary. The default of 1 reproduces the plain
+	 *		scheduling.
 	 */
 	template<int thread_count = -1,
 		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
 		 class Iterator, class Last, class Function,
 		 class = typename std::enable_if<std::is_same<Iterator,Last>::value ||
 						 !std::is_integral<Iterator>::value ||
@@ -346,14 +815,20 @@ namespace threadpool {
 	    unsigned int tc =
 		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
 
-	    if (tc <= 1) {
+	    if (tc <= 1)
 		return singlethreaded::parallel::for_each(first, last, fun);
-	    } else {
-		ThreadPoolImpl::impl::ForEachThreadPoolImpl<Iterator, Last, Function
-							    >(first, last, fun, thread_count,
-							      maxpart != 1 ? maxpart : 3 * (tc + 1));
-		return std::forward<Function>(fun);
-	    }
+
+	    /*
+	      Random access iterators are routed through the
+	      type-erased driver, other iterators through the template
+	      queue; see the dispatch helpers above.
+	    */
+	    ThreadPoolImpl::impl::run_parallel_for_each(first, last, fun,
+							thread_count,
+							maxpart != 1 ? maxpart : 3 * (tc + 1),
+							min_chunk,
+							typename std::iterator_traits<Iterator>::iterator_category());
+	    return std::forward<Function>(fun);
 	}
 
 	/**
@@ -377,7 +852,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -396,9 +874,19 @@ namespace threadpool {
 	 *		system determine a value, which is three times
 	 *		the number of threads. A value of 0 enforces
 	 *		single-object processing.
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take. The chunks shrink geometrically from
+	 *		remaining/maxpart toward this floor (guided
+	 *		self-scheduling), which reduces contention on
+	 *		the queue lock at the tail when element costs
+	 *		vary. The default of 1 reproduces the plain
+	 *		scheduling.
 	 */
 	template<int thread_count = -1,
 		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
 		 class Iterator, class Last, class Function,
 		 class = typename std::enable_if<!std::is_same<Iterator,Last>::value &&
 						 std::is_integral<Iterator>::value &&
@@ -418,7 +906,7 @@ namespace threadpool {
 	    typedef typename std::common_type<Iterator, Last>::type common_type;
 	    typedef ThreadPoolImpl::impl::IntegralIterator<common_type> CommonIterator;
 
-	    return for_each<thread_count, maxpart
+	    return for_each<thread_count, maxpart, min_chunk
 			    >(CommonIterator(std::forward<Iterator>(first)),
 			      CommonIterator(last),
 			      std::forward<Function>(fun));
@@ -445,7 +933,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -464,14 +955,24 @@ namespace threadpool {
 	 *		system determine a value, which is three times
 	 *		the number of threads. A value of 0 enforces
 	 *		single-object processing.
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take. The chunks shrink geometrically from
+	 *		remaining/maxpart toward this floor (guided
+	 *		self-scheduling), which reduces contention on
+	 *		the queue lock at the tail when element costs
+	 *		vary. The default of 1 reproduces the plain
+	 *		scheduling.
 	 */
 	template<int thread_count = -1,
 		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
 		 class Container, class Function>
 	typename std::decay<Function>::type
 	for_each(Container& container, Function&& fun)
 	{
-	    return for_each<thread_count, maxpart
+	    return for_each<thread_count, maxpart, min_chunk
 			    >(std::begin(container),
 			      std::end(container),
 			      std::forward<Function>(fun));
@@ -498,7 +999,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -517,20 +1021,242 @@ namespace threadpool {
 	 *		system determine a value, which is three times
 	 *		the number of threads. A value of 0 enforces
 	 *		single-object processing.
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take. The chunks shrink geometrically from
+	 *		remaining/maxpart toward this floor (guided
+	 *		self-scheduling), which reduces contention on
+	 *		the queue lock at the tail when element costs
+	 *		vary. The default of 1 reproduces the plain
+	 *		scheduling.
 	 */
 	template<int thread_count = -1,
 		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
 		 class Container, class Function,
 		 class = typename std::enable_if<!std::is_lvalue_reference<Container>::value>::type>
 	typename std::decay<Function>::type
 	for_each(Container&& container, Function&& fun)
 	{
-	    return for_each<thread_count, maxpart
+	    return for_each<thread_count, maxpart, min_chunk
 			    >(std::make_move_iterator(std::begin(container)),
 			      std::make_move_iterator(std::end(container)),
 			      std::forward<Function>(fun));
 	}
 
+	/**
+	 * Run a function on contiguous chunks of a range of random
+	 * access iterators.
+	 *
+	 * Unlike for_each(), which calls `fun(element)` once per
+	 * element, this calls `fun(begin, end)` once per chunk, so
+	 * the function can run a plain loop over the sub-range that
+	 * the compiler is able to vectorize. The chunks are the same
+	 * the guided scheduling of for_each() would produce; use the
+	 * min_chunk parameter to keep them large enough for the
+	 * vector width to pay off.
+	 *
+	 * @param first
+	 *		The start of the range to be processed.
+	 *
+	 * @param last
+	 *		One past the end of the range to be processed.
+	 *
+	 * @param fun
+	 *		The function to call with each chunk, callable
+	 *		as void(Iterator begin, Iterator end).
+	 *
+	 * @returns
+	 *		The final value of the function
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn; see
+	 *		for_each().
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take; see
+	 *		for_each().
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take; see for_each().
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Iterator, class Last, class Function,
+		 class = typename std::enable_if<std::is_same<Iterator,Last>::value ||
+						 !std::is_integral<Iterator>::value ||
+						 !std::is_integral<Last>::value
+						 >::type
+		 >
+	typename std::decay<Function>::type
+	for_each_blocked(Iterator first, const Last& last, Function&& fun)
+	{
+
+	    unsigned int tc =
+		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
+
+	    if (tc <= 1)
+		return singlethreaded::parallel::for_each_blocked(first, last, fun);
+
+	    /*
+	      Random access iterators are routed through the
+	      type-erased driver, other iterators through the template
+	      queue; see the dispatch helpers above.
+	    */
+	    ThreadPoolImpl::impl::run_parallel_for_each_blocked(first, last, fun,
+								thread_count,
+								maxpart != 1 ? maxpart : 3 * (tc + 1),
+								min_chunk,
+								typename std::iterator_traits<Iterator>::iterator_category());
+	    return std::forward<Function>(fun);
+	}
+
+	/**
+	 * Run a function on contiguous blocks of a range of integral
+	 * values.
+	 *
+	 * The function is called as `fun(lo, hi)` with half-open
+	 * integral bounds and is expected to loop from lo to hi
+	 * itself -- the form numeric kernels need for
+	 * auto-vectorization.
+	 *
+	 * @param first
+	 *		The start of the range to be processed.
+	 *
+	 * @param last
+	 *		One past the end of the range to be processed.
+	 *
+	 * @param fun
+	 *		The function to call with each block, callable
+	 *		as void(T lo, T hi) with T the common integral
+	 *		type of `first` and `last`.
+	 *
+	 * @returns
+	 *		The final value of the function
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn; see
+	 *		for_each().
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take; see
+	 *		for_each().
+	 *
+	 * @tparam min_chunk
+	 *		The smallest chunk of input a thread will
+	 *		take; see for_each().
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Iterator, class Last, class Function,
+		 class = typename std::enable_if<!std::is_same<Iterator,Last>::value &&
+						 std::is_integral<Iterator>::value &&
+						 std::is_integral<Last>::value
+						 >::type
+		 >
+	typename std::decay<Function>::type
+	for_each_blocked(Iterator&& first, const Last& last, Function&& fun)
+	{
+	    /*
+	      Extend to the common integral type, like for_each()
+	      does, then unwrap the iterators again so the kernel
+	      sees plain integral bounds.
+	     */
+	    typedef typename std::common_type<Iterator, Last>::type common_type;
+	    typedef ThreadPoolImpl::impl::IntegralIterator<common_type> CommonIterator;
+
+	    auto block_fun = [&fun](CommonIterator lo, const CommonIterator& hi) {
+		fun(*lo, *hi);
+	    };
+	    for_each_blocked<thread_count, maxpart, min_chunk
+			     >(CommonIterator(std::forward<Iterator>(first)),
+			       CommonIterator(last),
+			       block_fun);
+	    return std::forward<Function>(fun);
+	}
+
+	/**
+	 * The 2D index range type accepted by for_each_tiled().
+	 */
+	using ThreadPoolImpl::impl::Range2D;
+
+	/**
+	 * Run a function on rectangular tiles of a 2D index range.
+	 *
+	 * Instead of flattening a rows × cols iteration into one
+	 * dimension, the workers take rectangular tiles of the range
+	 * and call `fun(row_begin, row_end, col_begin, col_end)` once
+	 * per tile, so the working set of one call is a tile that fits
+	 * the cache. The tile shape can be specified in the range to
+	 * match the cache blocking of the kernel; by default both
+	 * dimensions are split evenly into about maxpart tiles.
+	 *
+	 * @param range
+	 *		The 2D index range to be processed, with an
+	 *		optional tile shape.
+	 *
+	 * @param fun
+	 *		The function to call with each tile, callable
+	 *		as void(T row_begin, T row_end, T col_begin,
+	 *		T col_end).
+	 *
+	 * @returns
+	 *		The final value of the function
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn. If the default
+	 *		value of -1 is specified, the thread count is
+	 *		determined based on the number of available
+	 *		hardware threads. A value of 1 selects the
+	 *		single-threaded algorithm, which still visits
+	 *		the range tile by tile. With the default, the
+	 *		call borrows the workers of the process-wide
+	 *		shared pool; an explicit thread count spawns a
+	 *		dedicated pool for this call.
+	 *
+	 * @tparam maxpart
+	 *		The number of tiles to split the range into
+	 *		when the range does not specify a tile
+	 *		shape. The default value of 1 lets the system
+	 *		determine a value, which is three times the
+	 *		number of threads. Ignored when the range
+	 *		specifies its tile shape.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class T, class Function>
+	typename std::decay<Function>::type
+	for_each_tiled(const Range2D<T>& range, Function&& fun)
+	{
+
+	    unsigned int tc =
+		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
+
+	    if (tc <= 1) {
+		return singlethreaded::parallel::for_each_tiled(range, fun);
+	    } else if (thread_count == -1) {
+		// Default: borrow the workers of the shared pool
+		// instead of spawning threads for this one call.
+		typename ThreadPoolImpl::impl::ForEachTiledThreadPoolImpl<T, Function
+									  >::Queue queue(range, fun,
+											 maxpart != 1 ? maxpart : 3 * (tc + 1));
+		ThreadPoolImpl::impl::run_on_shared_pool(queue, tc);
+		return std::forward<Function>(fun);
+	    } else {
+		// An explicit thread count requests a dedicated pool.
+		ThreadPoolImpl::impl::ForEachTiledThreadPoolImpl<T, Function
+								 >(range, fun, thread_count,
+								   maxpart != 1 ? maxpart : 3 * (tc + 1));
+		return std::forward<Function>(fun);
+	    }
+	}
+
     } // End of namespace parallel
 
 } // End of namespace threadpool
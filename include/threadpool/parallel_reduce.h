@@ -0,0 +1,600 @@
+/** @file threadpool/parallel_reduce.h
+ *
+ * Threadpool for C++11, parallel reduce
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef PARALLEL_REDUCE_H
+#define PARALLEL_REDUCE_H
+
+#include <cstddef>
+#include <type_traits>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+#include "impl/threadpool_generic.h"
+#include "impl/threadpool_impl_util.h"
+#include "impl/threadpool_impl_shared.h"
+#include "singlethreaded/parallel_reduce.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+	/*
+	  Reductions through the pool used to be a for_each with a
+	  mutex-guarded accumulator, which serializes the hot
+	  loop. Instead let each worker fold into a private
+	  accumulator in its work() loop, and merge the partial
+	  results under the lock only once per worker when its input
+	  is exhausted. The queue structure mirrors
+	  ForEachThreadPoolImpl_Queue, including the chunked
+	  specialization for random access iterators.
+	*/
+
+
+
+
+
+	/**
+	 * Queue folding single objects into per-worker accumulators.
+	 *
+	 * @relates ReduceThreadPoolImpl
+	 *	Conceptually ReduceThreadPoolImpl_Queue is a member
+	 *	of class ReduceThreadPoolImpl, but the standard does
+	 *	not allow template specialization inside classes. I
+	 *	had to move it out of the class.
+	 */
+	template<class Iterator, class Last, class T,
+		 class Reduce, class Combine, bool forward_iterator>
+	class ReduceThreadPoolImpl_Queue : public GenericThreadPoolQueue {
+
+	protected:
+
+	    Iterator& current;
+	    const Last& last;
+	    const T& init;
+	    T& result;
+	    Reduce& reduce;
+	    Combine& combine;
+	    std::mutex mutex; // Make sure threads do not access concurrently
+
+	public:
+
+	    ReduceThreadPoolImpl_Queue(Iterator& first,
+				       const Last& last,
+				       const T& init,
+				       T& result,
+				       Reduce& reduce,
+				       Combine& combine,
+				       std::size_t /*ignored*/ = 0)
+		: current(first),
+		  last(last),
+		  init(init),
+		  result(result),
+		  reduce(reduce),
+		  combine(combine)
+	    { }
+
+	    void work(bool /*ignored*/) override
+	    {
+		const Last& l(last);
+		T acc(init);
+		bool did_work = false;
+		for (;;) {
+		    std::unique_lock<std::mutex> lock(mutex);
+		    if (current == l)
+			break;
+		    typename iterval_traits<Iterator>::type v(iterval_traits<Iterator>::copy(current));
+		    ++current;
+		    lock.unlock();
+		    acc = reduce(std::move(acc), iterval_traits<Iterator>::pass(std::move(v)));
+		    did_work = true;
+		}
+		if (did_work) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    result = combine(std::move(result), std::move(acc));
+		}
+	    }
+
+	    /**
+	     * Shut the queue down, stop returning values
+	     */
+	    void shutdown() override
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		current = last;
+	    }
+	};
+
+
+
+
+
+	/**
+	 * Reduce objects from a container into a single value.
+	 *
+	 * Queue with `forward_iterator` == true takes groups of
+	 * objects from the queue, the same chunking as
+	 * ForEachThreadPoolImpl_Queue.
+	 *
+	 * This works only for random access iterators. The
+	 * specialization is selected with template parameter
+	 * forward_iterator = true. For all other iterators, use the
+	 * general case of the template above.
+	 *
+	 * @relates ReduceThreadPoolImpl
+	 *	Conceptually ReduceThreadPoolImpl_Queue is a member
+	 *	of class ReduceThreadPoolImpl, but the standard does
+	 *	not allow template specialization inside classes. I
+	 *	had to move it out of the class.
+	 */
+	template<class Iterator, class Last, class T, class Reduce, class Combine>
+	class ReduceThreadPoolImpl_Queue<Iterator, Last, T, Reduce, Combine, true>
+	    : public ReduceThreadPoolImpl_Queue<Iterator, Last, T, Reduce, Combine, false> {
+
+	    typedef ReduceThreadPoolImpl_Queue<Iterator, Last, T, Reduce, Combine, false> Base;
+
+	    const std::size_t maxpart;
+	    typename std::iterator_traits<Iterator>::difference_type remaining;
+
+	public:
+
+	    ReduceThreadPoolImpl_Queue(Iterator& first,
+				       const Last& last,
+				       const T& init,
+				       T& result,
+				       Reduce& reduce,
+				       Combine& combine,
+				       std::size_t maxpart)
+		: Base(first, last, init, result, reduce, combine),
+		  maxpart(maxpart),
+		  remaining(std::distance(first, last))
+	    { }
+
+	    void work(bool /*ignored*/) override
+	    {
+		const Last& last = this->last; // Does never change
+		T acc(this->init);
+		bool did_work = false;
+		for (;;) {
+		    Iterator c, l;
+		    {
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			if ((c = this->current) == last)
+			    break;
+
+			typename std::iterator_traits<Iterator>::difference_type stride =
+			    (maxpart == 0) ? 1 : remaining / maxpart;
+			if (stride <= 0)
+			    stride = 1;
+
+			l = c;
+			std::advance(l, stride);
+			this->current = l;
+			remaining -= stride;
+		    }
+
+		    while (c != l) {
+			acc = this->reduce(std::move(acc), *c);
+			++c;
+		    }
+		    did_work = true;
+		}
+		if (did_work) {
+		    std::lock_guard<std::mutex> lock(this->mutex);
+		    this->result = this->combine(std::move(this->result), std::move(acc));
+		}
+	    }
+
+	};
+
+
+
+
+
+	/**
+	 * A thread pool reducing a range to a single value.
+	 *
+	 * Each worker folds elements into a private accumulator
+	 * starting from a copy of `init`, and the partial results
+	 * are merged into the common result when the workers run
+	 * out of input. Because `init` seeds every worker as well as
+	 * the result, it must be an identity value of the reduction
+	 * (e.g. 0 for sums, the empty histogram for histogram
+	 * merges).
+	 *
+	 * @tparam Iterator
+	 *		The iterator type to be used to traverse the container.
+	 *
+	 * @tparam Last
+	 *		The iterator type for the last element.
+	 *
+	 * @tparam T
+	 *		The accumulator type.
+	 *
+	 * @tparam Reduce
+	 *		Binary function folding one element into an
+	 *		accumulator, called as
+	 *		`acc = reduce(std::move(acc), element)`.
+	 *
+	 * @tparam Combine
+	 *		Binary function merging two accumulators,
+	 *		called as `a = combine(std::move(a), std::move(b))`.
+	 */
+	template<class Iterator, class Last, class T, class Reduce, class Combine>
+	class ReduceThreadPoolImpl {
+
+	public:
+
+	    typedef ReduceThreadPoolImpl_Queue<Iterator, Last, T, Reduce, Combine,
+					       std::is_base_of<std::forward_iterator_tag,
+							       typename std::iterator_traits<Iterator>::iterator_category
+							       >::value
+					       > Queue;
+
+	private:
+
+	    const T init;
+	    T result;
+	    Queue queue;
+	    GenericThreadPool pool;
+
+	public:
+
+	    /**
+	     * Reduce the objects in an iterator range.
+	     *
+	     * @param first
+	     *			The start of the range to be processed.
+	     *
+	     * @param last
+	     *			One past the end of the range to be processed.
+	     *
+	     * @param init
+	     *			The identity value seeding each
+	     *			accumulator.
+	     *
+	     * @param reduce
+	     *			The function folding one element
+	     *			into an accumulator.
+	     *
+	     * @param combine
+	     *			The function merging two
+	     *			accumulators.
+	     *
+	     * @param thread_count
+	     *			The number of threads to use. If the
+	     *			thread count is specified as -1 it
+	     *			defaults to the number of available
+	     *			hardware threads
+	     *			std::thread::hardware_concurrency().
+	     *
+	     * @param maxpart
+	     *			The maximum part of the remaining
+	     *			input range that one thread is allowed
+	     *			to take, as in ForEachThreadPoolImpl.
+	     */
+	    ReduceThreadPoolImpl(Iterator& first, const Last& last,
+				 T&& init,
+				 Reduce& reduce, Combine& combine,
+				 int thread_count,
+				 std::size_t maxpart)
+		: init(std::move(init)),
+		  result(this->init),
+		  queue(first, last, this->init, result, reduce, combine, maxpart),
+		  pool(queue, thread_count)
+	    { }
+
+	    /**
+	     * Collect threads, throw any pending exceptions.
+	     *
+	     * Must be called before get(), so the result is no
+	     * longer concurrently modified.
+	     */
+	    void join()
+	    {
+		pool.join();
+	    }
+
+	    /**
+	     * Take the accumulated result. Only valid after join().
+	     */
+	    T get()
+	    {
+		return std::move(result);
+	    }
+
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+namespace threadpool {
+
+    namespace parallel {
+
+	/**
+	 * Reduce a range of iterators to a single value.
+	 *
+	 * Each worker thread folds elements into a private
+	 * accumulator, and the partial results are merged when the
+	 * input is exhausted, so the hot loop takes no lock.
+	 *
+	 * @param first
+	 *		The start of the range to be processed.
+	 *
+	 * @param last
+	 *		One past the end of the range to be processed.
+	 *
+	 * @param init
+	 *		The start value of the accumulation. Because
+	 *		it seeds the private accumulator of every
+	 *		worker, it must be an identity value of the
+	 *		reduction (e.g. 0 for sums).
+	 *
+	 * @param reduce_fun
+	 *		Binary function folding one element into the
+	 *		accumulator, called as
+	 *		`acc = reduce_fun(std::move(acc), element)`.
+	 *
+	 * @param combine_fun
+	 *		Binary function merging two accumulators,
+	 *		called as `a = combine_fun(std::move(a), std::move(b))`.
+	 *
+	 * @returns
+	 *		The accumulated value
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn. If the default
+	 *		value of -1 is specified, the thread count is
+	 *		determined based on the number of available
+	 *		hardware threads. A value of 1 selects the
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
+	 *
+	 * @tparam maxpart The maximum part of the remaining input
+	 *		range that one thread is allowed to take.  If
+	 *		maxpart is for example 5 and 100 elements
+	 *		remain to be processed, then a task will take
+	 *		100 / 5 = 20 elements and process them. If a
+	 *		large value is chosen for maxpart, each thread
+	 *		will take small chunks of work and will look
+	 *		for more work frequently, causing increased
+	 *		synchronization overhead. If a small value is
+	 *		chosen for maxpart, each thread will take huge
+	 *		chunks of work, possibly leaving the remaining
+	 *		threads out of work at the end. A good value
+	 *		might be three times the number of
+	 *		threads. The default value of 1 lets the
+	 *		system determine a value, which is three times
+	 *		the number of threads. A value of 0 enforces
+	 *		single-object processing.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class Iterator, class Last, class T,
+		 class Reduce, class Combine,
+		 class = typename std::enable_if<std::is_same<Iterator,Last>::value ||
+						 !std::is_integral<Iterator>::value ||
+						 !std::is_integral<Last>::value
+						 >::type
+		 >
+	typename std::decay<T>::type
+	reduce(Iterator first, const Last& last, T&& init,
+	       Reduce&& reduce_fun, Combine&& combine_fun)
+	{
+
+	    unsigned int tc =
+		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
+
+	    if (tc <= 1) {
+		return singlethreaded::parallel::reduce(first, last,
+							std::forward<T>(init),
+							reduce_fun, combine_fun);
+	    } else if (thread_count == -1) {
+		// Default: borrow the workers of the shared pool
+		// instead of spawning threads for this one call.
+		typedef typename std::decay<T>::type value_type;
+		const value_type init_value(std::forward<T>(init));
+		value_type result(init_value);
+		typename ThreadPoolImpl::impl::ReduceThreadPoolImpl<Iterator, Last, value_type,
+								    Reduce, Combine
+								    >::Queue queue(first, last, init_value, result,
+										   reduce_fun, combine_fun,
+										   maxpart != 1 ? maxpart : 3 * (tc + 1));
+		ThreadPoolImpl::impl::run_on_shared_pool(queue, tc);
+		return result;
+	    } else {
+		// An explicit thread count requests a dedicated pool.
+		typedef typename std::decay<T>::type value_type;
+		ThreadPoolImpl::impl::ReduceThreadPoolImpl<Iterator, Last, value_type,
+							   Reduce, Combine
+							   > impl(first, last,
+								  value_type(std::forward<T>(init)),
+								  reduce_fun, combine_fun,
+								  thread_count,
+								  maxpart != 1 ? maxpart : 3 * (tc + 1));
+		impl.join();
+		return impl.get();
+	    }
+	}
+
+	/**
+	 * Reduce a range of integral values to a single value.
+	 *
+	 * @param first
+	 *		The start of the range to be processed.
+	 *
+	 * @param last
+	 *		One past the end of the range to be processed.
+	 *
+	 * @param init
+	 *		The start value of the accumulation, an
+	 *		identity value of the reduction.
+	 *
+	 * @param reduce_fun
+	 *		Binary function folding one value into the
+	 *		accumulator.
+	 *
+	 * @param combine_fun
+	 *		Binary function merging two accumulators.
+	 *
+	 * @returns
+	 *		The accumulated value
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		iterator-range version.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class Iterator, class Last, class T,
+		 class Reduce, class Combine,
+		 class = typename std::enable_if<!std::is_same<Iterator,Last>::value &&
+						 std::is_integral<Iterator>::value &&
+						 std::is_integral<Last>::value
+						 >::type
+		 >
+	typename std::decay<T>::type
+	reduce(Iterator&& first, const Last& last, T&& init,
+	       Reduce&& reduce_fun, Combine&& combine_fun)
+	{
+	    /*
+	      We can not use the generic function because the user
+	      might specify `first` as 0 which makes type `Iterator'
+	      become `int`, and `last` as something of type
+	      `std::size_t` not representable in an `int`. This loop
+	      would run forever. Just extend type `Iterator`.
+	     */
+	    typedef typename std::common_type<Iterator, Last>::type common_type;
+	    typedef ThreadPoolImpl::impl::IntegralIterator<common_type> CommonIterator;
+
+	    return reduce<thread_count, maxpart
+			  >(CommonIterator(std::forward<Iterator>(first)),
+			    CommonIterator(last),
+			    std::forward<T>(init),
+			    std::forward<Reduce>(reduce_fun),
+			    std::forward<Combine>(combine_fun));
+	}
+
+	/**
+	 * Reduce all objects in a container to a single value.
+	 *
+	 * Version for lvalue containers. The objects in the container
+	 * are passed to `reduce_fun` by reference.
+	 *
+	 * @param container
+	 *		The container.
+	 *
+	 * @param init
+	 *		The start value of the accumulation, an
+	 *		identity value of the reduction.
+	 *
+	 * @param reduce_fun
+	 *		Binary function folding one element into the
+	 *		accumulator.
+	 *
+	 * @param combine_fun
+	 *		Binary function merging two accumulators.
+	 *
+	 * @returns
+	 *		The accumulated value
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		iterator-range version.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class Container, class T, class Reduce, class Combine>
+	typename std::decay<T>::type
+	reduce(Container& container, T&& init,
+	       Reduce&& reduce_fun, Combine&& combine_fun)
+	{
+	    return reduce<thread_count, maxpart
+			  >(std::begin(container),
+			    std::end(container),
+			    std::forward<T>(init),
+			    std::forward<Reduce>(reduce_fun),
+			    std::forward<Combine>(combine_fun));
+	}
+
+	/**
+	 * Reduce all objects in a container to a single value.
+	 *
+	 * Version for rvalue containers. The objects in the container
+	 * are passed to `reduce_fun` by rvalue reference, so they can
+	 * be move()d.
+	 *
+	 * @param container
+	 *		The container.
+	 *
+	 * @param init
+	 *		The start value of the accumulation, an
+	 *		identity value of the reduction.
+	 *
+	 * @param reduce_fun
+	 *		Binary function folding one element into the
+	 *		accumulator.
+	 *
+	 * @param combine_fun
+	 *		Binary function merging two accumulators.
+	 *
+	 * @returns
+	 *		The accumulated value
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		iterator-range version.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class Container, class T, class Reduce, class Combine,
+		 class = typename std::enable_if<!std::is_lvalue_reference<Container>::value>::type>
+	typename std::decay<T>::type
+	reduce(Container&& container, T&& init,
+	       Reduce&& reduce_fun, Combine&& combine_fun)
+	{
+	    return reduce<thread_count, maxpart
+			  >(std::make_move_iterator(std::begin(container)),
+			    std::make_move_iterator(std::end(container)),
+			    std::forward<T>(init),
+			    std::forward<Reduce>(reduce_fun),
+			    std::forward<Combine>(combine_fun));
+	}
+
+    } // End of namespace parallel
+
+} // End of namespace threadpool
+
+#endif // !defined(PARALLEL_REDUCE_H)
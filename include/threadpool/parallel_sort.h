@@ -0,0 +1,457 @@
+/** @file threadpool/parallel_sort.h
+ *
+ * Threadpool for C++11, parallel sort
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "impl/threadpool_generic.h"
+#include "impl/threadpool_impl_util.h"
+#include "impl/threadpool_impl_shared.h"
+#include "singlethreaded/parallel_sort.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+	/*
+	  A parallel merge sort on the pool machinery. The workers
+	  first take chunks of the input range from a shared cursor,
+	  with the same guided scheduling as
+	  ForEachThreadPoolImpl_Queue, and sort each chunk with
+	  std::sort(). A sorted run is then folded into its neighbors:
+	  under the lock the worker looks for an adjacent run that is
+	  already sorted, claims it, and merges the two with
+	  std::inplace_merge() outside the lock, repeating until no
+	  neighbor is ready. Runs without a ready neighbor are
+	  deposited in a map keyed by their start.
+
+	  Every range is at any time either being processed by a
+	  worker or deposited in the map, so the last worker to finish
+	  always finds its neighbors deposited and merges them; when
+	  the last work() call returns, a single sorted run spans the
+	  whole range. There is no round barrier: merges start as soon
+	  as two adjacent runs are sorted, while other workers still
+	  sort their first chunk.
+	*/
+
+
+
+
+
+	/**
+	 * Queue sorting chunks of a range and merging adjacent runs.
+	 *
+	 * Requires random access iterators, like std::sort().
+	 *
+	 * @relates SortThreadPoolImpl
+	 *	Conceptually SortThreadPoolImpl_Queue is a member of
+	 *	class SortThreadPoolImpl, moved out of the class to
+	 *	match the layout of the other algorithm queues.
+	 */
+	template<class Iterator, class Compare>
+	class SortThreadPoolImpl_Queue : public GenericThreadPoolQueue {
+
+	    typedef typename std::iterator_traits<Iterator>::difference_type difference_type;
+
+	    Iterator& current;
+	    const Iterator& last;
+	    Compare& comp;
+	    const std::size_t maxpart;
+	    const std::size_t min_chunk;
+	    difference_type remaining;
+	    std::map<Iterator, Iterator> runs; // Sorted runs awaiting a neighbor
+	    std::mutex mutex; // Make sure threads do not access concurrently
+
+	    /**
+	     * Fold the sorted run [a, b) into its neighbors.
+	     *
+	     * Claims an adjacent deposited run under the lock and
+	     * merges outside the lock, until no neighbor is ready;
+	     * then deposits the grown run.
+	     */
+	    void complete_run(Iterator a, Iterator b)
+	    {
+		for (;;) {
+		    Iterator lo, mid, hi;
+		    {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			typename std::map<Iterator, Iterator>::iterator n = runs.lower_bound(a);
+			if (n != runs.begin() && std::prev(n)->second == a) {
+			    --n;	// Left neighbor [lo, a) is ready
+			    lo = n->first;
+			    mid = a;
+			    hi = b;
+			} else if ((n = runs.find(b)) != runs.end()) {
+			    lo = a;	// Right neighbor [b, hi) is ready
+			    mid = b;
+			    hi = n->second;
+			} else {
+			    runs.insert(std::make_pair(a, b));
+			    return;
+			}
+			runs.erase(n);
+		    }
+
+		    std::inplace_merge(lo, mid, hi, comp);
+		    a = lo;
+		    b = hi;
+		}
+	    }
+
+	public:
+
+	    SortThreadPoolImpl_Queue(Iterator& first,
+				     const Iterator& last,
+				     Compare& comp,
+				     std::size_t maxpart,
+				     std::size_t min_chunk = 1)
+		: current(first),
+		  last(last),
+		  comp(comp),
+		  maxpart(maxpart),
+		  min_chunk(min_chunk ? min_chunk : 1),
+		  remaining(std::distance(first, last))
+	    { }
+
+	    void work(bool /*ignored*/) override
+	    {
+		const Iterator& last = this->last; // Does never change
+		for (;;) {
+		    Iterator a, b;
+		    {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (current == last)
+			    break;
+
+			difference_type stride =
+			    (maxpart == 0) ? 1 : remaining / maxpart;
+			if (stride < static_cast<difference_type>(min_chunk))
+			    stride = min_chunk;
+			if (stride > remaining)
+			    stride = remaining;
+
+			a = current;
+			b = a;
+			std::advance(b, stride);
+			current = b;
+			remaining -= stride;
+		    }
+
+		    std::sort(a, b, comp);
+		    complete_run(a, b);
+		}
+	    }
+
+	    /**
+	     * Shut the queue down, stop handing out chunks.
+	     *
+	     * Deposited runs are left unmerged; the range keeps the
+	     * elements it had, in unspecified order.
+	     */
+	    void shutdown() override
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		current = last;
+		remaining = 0;
+	    }
+	};
+
+
+
+
+
+	/**
+	 * A thread pool sorting a random access range.
+	 *
+	 * The chunk handout follows the guided scheduling of
+	 * ForEachThreadPoolImpl; the merging of sorted runs overlaps
+	 * with the sorting of later chunks.
+	 *
+	 * @tparam Iterator
+	 *		The random access iterator type to traverse
+	 *		the range.
+	 *
+	 * @tparam Compare
+	 *		The comparison function, a strict weak
+	 *		ordering as for std::sort().
+	 */
+	template<class Iterator, class Compare>
+	class SortThreadPoolImpl {
+
+	public:
+
+	    typedef SortThreadPoolImpl_Queue<Iterator, Compare> Queue;
+
+	private:
+
+	    Queue queue;
+	    GenericThreadPool pool;
+
+	public:
+
+	    /**
+	     * Sort the objects in an iterator range.
+	     *
+	     * @param first
+	     *			The start of the range to be sorted.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			sorted.
+	     *
+	     * @param comp
+	     *			The comparison function.
+	     *
+	     * @param thread_count
+	     *			The number of threads to use. If the
+	     *			thread count is specified as -1 it
+	     *			defaults to the number of available
+	     *			hardware threads
+	     *			std::thread::hardware_concurrency().
+	     *
+	     * @param maxpart
+	     *			The maximum part of the remaining
+	     *			input range that one thread is allowed
+	     *			to take, as in ForEachThreadPoolImpl.
+	     *
+	     * @param min_chunk
+	     *			The minimum number of elements in a
+	     *			chunk. Sorting very small chunks
+	     *			wastes the merge work; a few thousand
+	     *			elements is a good value.
+	     */
+	    SortThreadPoolImpl(Iterator& first, const Iterator& last,
+			       Compare& comp,
+			       int thread_count,
+			       std::size_t maxpart,
+			       std::size_t min_chunk = 1)
+		: queue(first, last, comp, maxpart, min_chunk),
+		  pool(queue, thread_count)
+	    { }
+
+	    /**
+	     * Collect threads, throw any pending exceptions.
+	     */
+	    void join()
+	    {
+		pool.join();
+	    }
+
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+namespace threadpool {
+
+    namespace parallel {
+
+	/**
+	 * Sort a range of random access iterators.
+	 *
+	 * A parallel merge sort: the workers sort chunks of the range
+	 * with std::sort() and merge adjacent sorted runs with
+	 * std::inplace_merge() as soon as both are ready, overlapping
+	 * the merges with the sorting of later chunks. The sort is
+	 * not stable.
+	 *
+	 * @param first
+	 *		The start of the range to be sorted.
+	 *
+	 * @param last
+	 *		One past the end of the range to be sorted.
+	 *
+	 * @param comp
+	 *		The comparison function, a strict weak ordering
+	 *		as for std::sort(). It is called concurrently
+	 *		from multiple threads and must be thread-safe.
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn. If the default
+	 *		value of -1 is specified, the thread count is
+	 *		determined based on the number of available
+	 *		hardware threads. A value of 1 selects the
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in
+	 *		parallel::for_each(). It determines the number
+	 *		of sorted runs and with it the depth of the
+	 *		merging. The default value of 1 lets the system
+	 *		determine a value, which is three times the
+	 *		number of threads.
+	 *
+	 * @tparam min_chunk
+	 *		The minimum number of elements in a
+	 *		chunk. Sorting very small chunks wastes the
+	 *		merge work; a few thousand elements is a good
+	 *		value.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Iterator, class Compare>
+	void sort(Iterator first, Iterator last, Compare comp)
+	{
+
+	    unsigned int tc =
+		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
+
+	    if (first == last)
+		return;
+
+	    if (tc <= 1) {
+		singlethreaded::parallel::sort(first, last, std::move(comp));
+	    } else if (thread_count == -1) {
+		// Default: borrow the workers of the shared pool
+		// instead of spawning threads for this one call.
+		typename ThreadPoolImpl::impl::SortThreadPoolImpl<Iterator, Compare
+								  >::Queue queue(first, last, comp,
+										 maxpart != 1 ? maxpart : 3 * (tc + 1),
+										 min_chunk);
+		ThreadPoolImpl::impl::run_on_shared_pool(queue, tc);
+	    } else {
+		// An explicit thread count requests a dedicated pool.
+		ThreadPoolImpl::impl::SortThreadPoolImpl<Iterator, Compare
+							 > impl(first, last, comp,
+								thread_count,
+								maxpart != 1 ? maxpart : 3 * (tc + 1),
+								min_chunk);
+		impl.join();
+	    }
+	}
+
+	/**
+	 * Sort a range of random access iterators with operator<.
+	 *
+	 * @param first
+	 *		The start of the range to be sorted.
+	 *
+	 * @param last
+	 *		One past the end of the range to be sorted.
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		version with a comparison function.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		version with a comparison function.
+	 *
+	 * @tparam min_chunk
+	 *		The minimum number of elements in a chunk, as
+	 *		in the version with a comparison function.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Iterator>
+	void sort(Iterator first, Iterator last)
+	{
+	    typedef typename std::iterator_traits<Iterator>::value_type value_type;
+
+	    sort<thread_count, maxpart, min_chunk
+		 >(first, last, std::less<value_type>());
+	}
+
+	/**
+	 * Sort the objects in a container.
+	 *
+	 * @param container
+	 *		The container, with random access iterators.
+	 *
+	 * @param comp
+	 *		The comparison function, a strict weak ordering
+	 *		as for std::sort(). It is called concurrently
+	 *		from multiple threads and must be thread-safe.
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam min_chunk
+	 *		The minimum number of elements in a chunk, as
+	 *		in the iterator-range version.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Container, class Compare,
+		 class = decltype(*std::begin(std::declval<Container&>()))>
+	void sort(Container& container, Compare comp)
+	{
+	    sort<thread_count, maxpart, min_chunk
+		 >(std::begin(container),
+		   std::end(container),
+		   std::move(comp));
+	}
+
+	/**
+	 * Sort the objects in a container with operator<.
+	 *
+	 * @param container
+	 *		The container, with random access iterators.
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, as in the
+	 *		iterator-range version.
+	 *
+	 * @tparam min_chunk
+	 *		The minimum number of elements in a chunk, as
+	 *		in the iterator-range version.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 std::size_t min_chunk = 1,
+		 class Container,
+		 class = decltype(*std::begin(std::declval<Container&>()))>
+	void sort(Container& container)
+	{
+	    sort<thread_count, maxpart, min_chunk
+		 >(std::begin(container),
+		   std::end(container));
+	}
+
+    } // End of namespace parallel
+
+} // End of namespace threadpool
+
+#endif // !defined(PARALLEL_SORT_H)
@@ -15,9 +15,13 @@
 #include <iterator>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 #include "impl/threadpool_generic.h"
 #include "impl/threadpool_impl_util.h"
+#include "impl/threadpool_impl_shared.h"
+#include "impl/threadpool_impl_drive.h"
+#include "make_iterator.h"
 #include "singlethreaded/parallel_transform.h"
 
 namespace ThreadPoolImpl {
@@ -28,6 +32,61 @@ namespace ThreadPoolImpl {
 
 
 
+	/**
+	 * Whether a container supports reserve(), detected so
+	 * transform_into() can pre-allocate for vector-like
+	 * containers and still accept lists and deques.
+	 */
+	template<class Container>
+	class has_reserve {
+	    template<class C> static char test(decltype(std::declval<C&>().reserve(1))*);
+	    template<class C> static int test(...);
+	public:
+	    static const bool value = sizeof(test<Container>(nullptr)) == sizeof(char);
+	};
+
+	template<class Container>
+	inline typename std::enable_if<has_reserve<Container>::value>::type
+	reserve_capacity(Container& container, std::size_t n) {
+	    container.reserve(n);
+	}
+
+	template<class Container>
+	inline typename std::enable_if<!has_reserve<Container>::value>::type
+	reserve_capacity(Container&, std::size_t) { }
+
+	/**
+	 * Length of an input range, when it is knowable without
+	 * consuming the range: for forward iterators with equal
+	 * bound types. 0 otherwise, which makes the reserve above a
+	 * no-op.
+	 */
+	template<class Iterator, class Last>
+	inline typename std::enable_if<
+	    std::is_same<Iterator, Last>::value &&
+	    std::is_base_of<std::forward_iterator_tag,
+			    typename std::iterator_traits<Iterator>::iterator_category
+			    >::value,
+	    std::size_t>::type
+	input_length(const Iterator& first, const Last& last) {
+	    return static_cast<std::size_t>(std::distance(first, last));
+	}
+
+	template<class Iterator, class Last>
+	inline typename std::enable_if<
+	    !(std::is_same<Iterator, Last>::value &&
+	      std::is_base_of<std::forward_iterator_tag,
+			      typename std::iterator_traits<Iterator>::iterator_category
+			      >::value),
+	    std::size_t>::type
+	input_length(const Iterator&, const Last&) {
+	    return 0;
+	}
+
+
+
+
+
 	/*
 	  Now write a parallel version of std::transform().
 
@@ -82,8 +141,15 @@ namespace ThreadPoolImpl {
 		 class OutputIterator, class Function, bool forward_iterator>
 	class TransformThreadPoolImpl_Queue : public GenericThreadPoolQueue {
 
+	    typedef typename std::remove_reference<decltype(std::declval<Function&>()(*std::declval<InputIterator>()))>::type result_type;
+
+	    /*
+	      Workers buffer their results per input chunk instead of
+	      per element, so the output mutex is taken once per
+	      chunk and the hot loop runs without any lock.
+	    */
 	    struct Results {
-		typename std::remove_reference<decltype(std::declval<Function&>()(*std::declval<InputIterator>()))>::type result;
+		std::vector<result_type> results;
 		std::unique_ptr<Results> next;
 	    };
 
@@ -96,14 +162,39 @@ namespace ThreadPoolImpl {
 
 
 	    typedef unsigned long long int counter_type;
-	    counter_type input_counter = 1; // Counter of objects got from the queue
-	    counter_type output_counter = 1; // Counter of objects written
+	    static const std::size_t chunk_size = 16; // Elements taken per input lock
+	    counter_type input_counter = 1; // Counter of chunks got from the queue
+	    counter_type output_counter = 1; // Counter of chunks written
 	    Results* previous_results = nullptr;
-	    counter_type max_output_queue_length = 1000; // This should be configurable
+	    counter_type max_output_queue_length = 128; // Buffered chunks; should be configurable
 	    std::mutex output_mutex;
 	    std::condition_variable output_queue;
 	    std::size_t output_queue_waiters = 0;
-	
+
+	    /**
+	     * Take up to chunk_size input values. Called under the
+	     * input lock; general case, one iterator round trip per
+	     * element.
+	     */
+	    void grab_chunk(std::vector<typename iterval_traits<InputIterator>::type>& values,
+			    std::false_type)
+	    {
+		while (values.size() != chunk_size && current != last) {
+		    values.push_back(iterval_traits<InputIterator>::copy(current));
+		    ++current;
+		}
+	    }
+
+	    /**
+	     * Take up to chunk_size input values from a bulk-pullable
+	     * generator iterator in one call; see has_bulk_pull.
+	     */
+	    void grab_chunk(std::vector<typename iterval_traits<InputIterator>::type>& values,
+			    std::true_type)
+	    {
+		current.pull(values, chunk_size);
+	    }
+
 
 
 	public:
@@ -123,6 +214,7 @@ namespace ThreadPoolImpl {
 	    {
 
 		std::unique_ptr<Results> results;
+		std::vector<typename iterval_traits<InputIterator>::type> values;
 		const Last& last(this->last); // Does never change.
 		for (;;) {
 		    if (!results)
@@ -138,11 +230,18 @@ namespace ThreadPoolImpl {
 			ctr = input_counter;
 			prvres = previous_results;
 			previous_results = &*results;
-			typename iterval_traits<InputIterator>::type v(iterval_traits<InputIterator>::copy(current));
-			++current;
+			grab_chunk(values,
+				   std::integral_constant<bool,
+							  has_bulk_pull<InputIterator>::value>());
 			input_counter = ctr + 1;
 			lock.unlock();
-			results->result = fun(iterval_traits<InputIterator>::pass(std::move(v)));
+
+			// Compute the whole chunk without any lock.
+			results->results.clear();
+			results->results.reserve(values.size());
+			for (auto& v: values)
+			    results->results.push_back(fun(iterval_traits<InputIterator>::pass(std::move(v))));
+			values.clear();
 		    }
 
 
@@ -167,20 +266,24 @@ namespace ThreadPoolImpl {
 			    output_queue.wait(lock);
 			    --output_queue_waiters;
 			}
-			
+
 			if (output_counter == ctr) {
 			    // Predecessor is done, we can store our things.
 			    lock.unlock();
-			    *result = std::move(results->result);
-			    ++result;
+			    for (auto& r: results->results) {
+				*result = std::move(r);
+				++result;
+			    }
 			    ++ctr;
 			    lock.lock();
 			    // Now look whether our successors have left us their work.
 			    while (results->next) {
 				results = std::move(results->next);
 				lock.unlock();
-				*result = std::move(results->result);
-				++result;
+				for (auto& r: results->results) {
+				    *result = std::move(r);
+				    ++result;
+				}
 				++ctr;
 				lock.lock();
 			    }
@@ -339,6 +442,8 @@ namespace ThreadPoolImpl {
 		 class OutputIterator, class Function>
 	class TransformThreadPoolImpl {
 
+	public:
+
 	    typedef TransformThreadPoolImpl_Queue<InputIterator, Last, OutputIterator, Function,
 		std::is_base_of<std::forward_iterator_tag,
 				typename std::iterator_traits<InputIterator>::iterator_category
@@ -348,6 +453,8 @@ namespace ThreadPoolImpl {
 				>::value
 	    > Queue;
 
+	private:
+
 	    Queue queue;
 	    GenericThreadPool pool;
 
@@ -424,6 +531,69 @@ namespace ThreadPoolImpl {
 
 
 
+	/*
+	  Driver dispatch, as in parallel_for_each.h: when both the
+	  input and the output iterator are random access, the call is
+	  routed through the type-erased ParallelDrive and the queue
+	  machinery compiles once; all other combinations -- including
+	  the ordered chunk merge for output through back_inserter --
+	  keep the template queues.
+	*/
+
+	template<class InputIterator, class Last,
+		 class OutputIterator, class Function>
+	void run_parallel_transform(InputIterator first, const Last& last,
+				    OutputIterator& result, Function& fun,
+				    int thread_count, std::size_t maxpart,
+				    std::true_type /*random access in and out*/)
+	{
+	    typedef typename std::iterator_traits<InputIterator>::difference_type in_difference_type;
+	    typedef typename std::iterator_traits<OutputIterator>::difference_type out_difference_type;
+	    const std::size_t count =
+		static_cast<std::size_t>(std::distance(first, last));
+	    const InputIterator in_base = first;
+	    const OutputIterator out_base = result;
+
+	    ParallelDrive::drive_blocked(count, thread_count, maxpart, 1,
+		[&in_base, &out_base, &fun](std::size_t lo, std::size_t hi) {
+		    InputIterator c = in_base + static_cast<in_difference_type>(lo);
+		    const InputIterator l = in_base + static_cast<in_difference_type>(hi);
+		    OutputIterator r = out_base + static_cast<out_difference_type>(lo);
+		    while (c != l) {
+			*r = fun(*c);
+			++c;
+			++r;
+		    }
+		});
+
+	    std::advance(result, count); // As the queue would have left it
+	}
+
+	template<class InputIterator, class Last,
+		 class OutputIterator, class Function>
+	void run_parallel_transform(InputIterator first, const Last& last,
+				    OutputIterator& result, Function& fun,
+				    int thread_count, std::size_t maxpart,
+				    std::false_type)
+	{
+	    if (thread_count == -1) {
+		typename TransformThreadPoolImpl<InputIterator, Last,
+						 OutputIterator, Function
+						 >::Queue queue(first, last, result, fun,
+								maxpart);
+		run_on_shared_pool(queue,
+				   GenericThreadPool::determine_thread_count(thread_count));
+	    } else {
+		TransformThreadPoolImpl<InputIterator, Last,
+					OutputIterator, Function
+					>(first, last, result, fun, thread_count,
+					  maxpart);
+	    }
+	}
+
+
+
+
 
     } // End of namespace impl
 
@@ -462,7 +632,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -498,15 +671,25 @@ namespace threadpool {
 	    unsigned int tc =
 		ThreadPoolImpl::impl::GenericThreadPool::determine_thread_count(thread_count);
 
-	    if (tc <= 1) {
+	    if (tc <= 1)
 		return singlethreaded::parallel::transform(first, last, result, fun);
-	    } else {
-		ThreadPoolImpl::impl::TransformThreadPoolImpl<InputIterator, Last,
-							      OutputIterator, Function
-							      >(first, last, result, fun, thread_count,
-								maxpart != 1 ? maxpart : 3 * (tc + 1));
-		return result;
-	    }
+
+	    /*
+	      Random access input and output is routed through the
+	      type-erased driver, everything else through the template
+	      queue; see the dispatch helpers above.
+	    */
+	    ThreadPoolImpl::impl::run_parallel_transform(first, last, result, fun,
+			thread_count,
+			maxpart != 1 ? maxpart : 3 * (tc + 1),
+			std::integral_constant<bool,
+			    std::is_base_of<std::random_access_iterator_tag,
+					    typename std::iterator_traits<InputIterator>::iterator_category
+					    >::value &&
+			    std::is_base_of<std::random_access_iterator_tag,
+					    typename std::iterator_traits<OutputIterator>::iterator_category
+					    >::value>());
+	    return result;
 	}
 
 	/**
@@ -534,7 +717,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -607,7 +793,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -664,7 +853,10 @@ namespace threadpool {
 	 *		value of -1 is specified, the thread count is
 	 *		determined based on the number of available
 	 *		hardware threads. A value of 1 selects the
-	 *		single-threaded algorithm.
+	 *		single-threaded algorithm. With the default,
+	 *		the call borrows the workers of the
+	 *		process-wide shared pool; an explicit thread
+	 *		count spawns a dedicated pool for this call.
 	 *
 	 * @tparam maxpart The maximum part of the remaining input
 	 *		range that one thread is allowed to take.  If
@@ -699,6 +891,114 @@ namespace threadpool {
 			       std::forward<Function>(fun));
 	}
 
+	/**
+	 * Run a function on all objects in a range of iterators,
+	 * emplace the return values at the back of a container.
+	 *
+	 * The container is cleared, reserved once for the whole
+	 * input length (when the length is knowable and the
+	 * container supports reserve()), and each result is then
+	 * constructed directly in its final slot through
+	 * emplace_back() -- no pre-sizing with default-constructed
+	 * elements, no mutex-guarded back_inserter, no growth
+	 * reallocation and no assignment per element. The results
+	 * arrive in input order.
+	 *
+	 * @param first
+	 *		The start of the range to be processed.
+	 *
+	 * @param last
+	 *		One past the end of the range to be processed.
+	 *
+	 * @param result
+	 *		The container receiving the return values.
+	 *
+	 * @param fun
+	 *		The function to apply to all objects in the
+	 *		range.
+	 *
+	 * @returns
+	 *		A reference to the result container.
+	 *
+	 * @tparam thread_count
+	 *		The number of threads to spawn, like for
+	 *		transform().
+	 *
+	 * @tparam maxpart
+	 *		The maximum part of the remaining input range
+	 *		that one thread is allowed to take, like for
+	 *		transform().
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class InputIterator, class Last,
+		 class Container, class Function,
+		 class = typename std::enable_if<std::is_same<InputIterator,Last>::value ||
+						 !std::is_integral<InputIterator>::value ||
+						 !std::is_integral<Last>::value
+						 >::type
+		 >
+	Container&
+	transform_into(InputIterator first, const Last& last,
+		       Container& result, Function&& fun)
+	{
+	    result.clear();
+	    ThreadPoolImpl::impl::reserve_capacity(
+		result, ThreadPoolImpl::impl::input_length(first, last));
+	    transform<thread_count, maxpart
+		      >(first, last,
+			ThreadPoolImpl::impl::EmplaceOutputIterator<Container>(result),
+			std::forward<Function>(fun));
+	    return result;
+	}
+
+	/**
+	 * Run a function with each of a range of integral values,
+	 * emplace the return values at the back of a container.
+	 *
+	 * Integral-range version of transform_into() above; the
+	 * container is reserved once for the whole range.
+	 */
+	template<int thread_count = -1,
+		 unsigned int maxpart = 1,
+		 class InputIterator, class Last,
+		 class Container, class Function,
+		 class = typename std::enable_if<!std::is_same<InputIterator,Last>::value &&
+						 std::is_integral<InputIterator>::value &&
+						 std::is_integral<Last>::value
+						 >::type
+		 >
+	Container&
+	transform_into(InputIterator&& first, const Last& last,
+		       Container& result, Function&& fun)
+	{
+	    typedef typename std::common_type<InputIterator, Last>::type common_type;
+	    typedef ThreadPoolImpl::impl::IntegralIterator<common_type> CommonIterator;
+
+	    return transform_into<thread_count, maxpart
+				  >(CommonIterator(std::forward<InputIterator>(first)),
+				    CommonIterator(last),
+				    result, std::forward<Function>(fun));
+	}
+
+	/**
+	 * Run a function on all objects in a container, emplace the
+	 * return values at the back of a result container.
+	 *
+	 * Container version of transform_into() above.
+	 */
+	template<int thread_count = -1,
+		 std::size_t maxpart = 1,
+		 class InputContainer, class Container, class Function>
+	Container&
+	transform_into(InputContainer& container,
+		       Container& result, Function&& fun)
+	{
+	    return transform_into<thread_count, maxpart
+				  >(std::begin(container), std::end(container),
+				    result, std::forward<Function>(fun));
+	}
+
     } // End of namespace parallel
 
 } // End of namespace threadpool
@@ -0,0 +1,265 @@
+/** @file threadpool/pipeline.h
+ *
+ * Threadpool for C++11, pipeline of chained stages
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_PIPELINE_H
+#define THREADPOOL_PIPELINE_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "threadpool_config.h"
+#include "impl/threadpool_impl_homogenous.h"
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+	/*
+	  Record processing in stages (decode -> transform -> encode)
+	  is usually glued together from several pools and
+	  hand-written bounded buffers. The buffers are not needed:
+	  the queue of a HomogenousThreadPool is already bounded, and
+	  its put() already blocks the producer when the consumer
+	  stage falls behind. A pipeline is therefore just one
+	  HomogenousThreadPool per stage, where each task runs the
+	  stage function on one item and put()s the result into the
+	  next stage's queue. Items are moved stage to stage, never
+	  copied.
+	*/
+
+
+
+
+
+	/**
+	 * Description of one pipeline stage, as built by stage().
+	 *
+	 * @tparam Function
+	 *		The stage function. Called with one item
+	 *		(by rvalue); the returned value is handed to
+	 *		the next stage. The last stage of a pipeline
+	 *		returns void.
+	 */
+	template<class Function>
+	struct PipelineStage {
+	    int thread_count;
+	    std::size_t queue_size;
+	    Function fun;
+
+	    PipelineStage(int thread_count, std::size_t queue_size, Function&& fun)
+		: thread_count(thread_count),
+		  queue_size(queue_size),
+		  fun(std::move(fun))
+	    { }
+	};
+
+
+
+
+
+	/**
+	 * The pipeline: one thread pool per stage, the queues
+	 * between the stages bounded by each pool's queue_size.
+	 *
+	 * The first template parameter is the input item type, the
+	 * rest are the stage functions. Each non-terminal stage task
+	 * computes `fun(std::move(item))` and put()s the result into
+	 * the next stage; when that queue is full, put() blocks the
+	 * stage and backpressure propagates toward the producer.
+	 */
+	template<class Input, class... Functions>
+	class PipelineImpl;
+
+	/**
+	 * Terminal stage: consumes items, returns nothing.
+	 */
+	template<class Input, class Function>
+	class PipelineImpl<Input, Function> {
+
+	    /**
+	     * One queued item bound to its pipeline.
+	     */
+	    class Task {
+		PipelineImpl* pipeline;
+		Input item;
+	    public:
+		Task(PipelineImpl* pipeline, Input&& item)
+		    : pipeline(pipeline), item(std::move(item)) { }
+		Task(Task&& x)
+		    : pipeline(x.pipeline), item(std::move(x.item)) { }
+		void operator()() {
+		    pipeline->fun(std::move(item));
+		}
+	    };
+
+	    Function fun;
+	    HomogenousThreadPool<Task> pool;
+
+	public:
+
+	    explicit PipelineImpl(PipelineStage<Function>&& s)
+		: fun(std::move(s.fun)),
+		  pool(s.thread_count, s.queue_size)
+	    { }
+
+	    /**
+	     * Feed one item into the stage. Blocks when the stage's
+	     * queue is at capacity.
+	     */
+	    void push(Input item) {
+		pool.run(Task(this, std::move(item)));
+	    }
+
+	    /**
+	     * Wait until the stage has consumed everything fed to
+	     * it. Rethrows a pending exception of the stage.
+	     */
+	    void wait() {
+		pool.wait();
+	    }
+	};
+
+	/**
+	 * Non-terminal stage: computes and forwards to the next
+	 * stage.
+	 */
+	template<class Input, class Function, class... Rest>
+	class PipelineImpl<Input, Function, Rest...> {
+
+	    typedef typename std::result_of<Function&(Input&&)>::type Output;
+	    typedef PipelineImpl<Output, Rest...> Next;
+
+	    class Task {
+		PipelineImpl* pipeline;
+		Input item;
+	    public:
+		Task(PipelineImpl* pipeline, Input&& item)
+		    : pipeline(pipeline), item(std::move(item)) { }
+		Task(Task&& x)
+		    : pipeline(x.pipeline), item(std::move(x.item)) { }
+		void operator()() {
+		    pipeline->next.push(pipeline->fun(std::move(item)));
+		}
+	    };
+
+	    Function fun;
+
+	    /*
+	      Declaration order matters: `next` before `pool`, so
+	      this stage's pool is waited for and destroyed first and
+	      can still push into `next` until the end.
+	    */
+	    Next next;
+	    HomogenousThreadPool<Task> pool;
+
+	public:
+
+	    template<class... RestStages>
+	    PipelineImpl(PipelineStage<Function>&& s, RestStages&&... rest)
+		: fun(std::move(s.fun)),
+		  next(std::forward<RestStages>(rest)...),
+		  pool(s.thread_count, s.queue_size)
+	    { }
+
+	    /**
+	     * Feed one item into the first stage. Blocks when that
+	     * stage's queue is at capacity (backpressure).
+	     */
+	    void push(Input item) {
+		pool.run(Task(this, std::move(item)));
+	    }
+
+	    /**
+	     * Wait until every item fed so far has passed through
+	     * all stages. Call after the producers have stopped
+	     * pushing. Rethrows the first pending exception of the
+	     * stages.
+	     */
+	    void wait() {
+		pool.wait();
+		next.wait();
+	    }
+	};
+
+
+
+
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+
+
+/*
+  Export exported symbols to namespace `threadpool`.
+*/
+namespace threadpool {
+
+    /**
+     * Describe one pipeline stage for make_pipeline().
+     *
+     * @param thread_count
+     *		The parallelism of the stage: the number of worker
+     *		threads its pool spawns. -1 uses the number of
+     *		hardware threads. Use 1 for stages that must process
+     *		items one at a time.
+     *
+     * @param fun
+     *		The stage function. Receives one item by rvalue;
+     *		its return value is moved to the next stage. The
+     *		last stage returns void.
+     *
+     * @param queue_size
+     *		The capacity of the stage's input queue; a producer
+     *		blocks when it is full (backpressure). 0 selects the
+     *		default capacity.
+     */
+    template<class Function>
+    ThreadPoolImpl::impl::PipelineStage<typename std::decay<Function>::type>
+    stage(int thread_count, Function&& fun, std::size_t queue_size = 0) {
+	return ThreadPoolImpl::impl::PipelineStage<typename std::decay<Function>::type>(
+	    thread_count, queue_size, std::forward<Function>(fun));
+    }
+
+    /**
+     * Build a pipeline of chained stages with bounded queues in
+     * between.
+     *
+     * The input item type must be given explicitly; the
+     * intermediate types are deduced by chaining the stage function
+     * signatures. Example:
+     *
+     *     auto p = threadpool::make_pipeline<Record>(
+     *         threadpool::stage(2, decode),
+     *         threadpool::stage(4, transform),
+     *         threadpool::stage(1, encode));    // Returns void
+     *     p->push(record);
+     *     ...
+     *     p->wait();
+     *
+     * Items are moved from stage to stage; when a stage falls
+     * behind, its bounded queue blocks the stage before it, all the
+     * way back to push(). The destructor drains the pipeline like
+     * the thread pool destructor drains the pool.
+     */
+    template<class Input, class... Functions>
+    std::unique_ptr<ThreadPoolImpl::impl::PipelineImpl<Input, Functions...> >
+    make_pipeline(ThreadPoolImpl::impl::PipelineStage<Functions>&&... stages) {
+	return std::unique_ptr<ThreadPoolImpl::impl::PipelineImpl<Input, Functions...> >(
+	    new ThreadPoolImpl::impl::PipelineImpl<Input, Functions...>(std::move(stages)...));
+    }
+
+} // End of namespace threadpool
+
+#endif // !defined(THREADPOOL_PIPELINE_H)
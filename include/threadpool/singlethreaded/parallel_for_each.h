@@ -120,6 +120,132 @@ namespace threadpool {
 				  std::forward<Function>(fun));
 	    }
 
+	    /**
+	     * Run a function on contiguous chunks of a range of
+	     * iterators.
+	     *
+	     * @param first
+	     *			The start of the range to be
+	     *			processed.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			processed.
+	     *
+	     * @param fun
+	     *			The function to call with each chunk,
+	     *			callable as void(Iterator, Iterator).
+	     *
+	     * Single-threaded version of parallel for_each_blocked:
+	     * the whole range is one chunk. The template parameters
+	     * are unused but left for API compatibility.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Iterator, class Last, class Function,
+		     class = typename std::enable_if<std::is_same<Iterator,Last>::value ||
+						     !std::is_integral<Iterator>::value ||
+						     !std::is_integral<Last>::value
+						     >::type
+		     >
+	    typename std::decay<Function>::type
+	    for_each_blocked(Iterator first, const Last& last, Function&& fun)
+	    {
+		if (first != last)
+		    fun(first, last);
+
+		return std::forward<Function>(fun);
+	    }
+
+	    /**
+	     * Run a function on contiguous blocks of a range of
+	     * integral values.
+	     *
+	     * @param first
+	     *			The start of the range to be
+	     *			processed.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			processed.
+	     *
+	     * @param fun
+	     *			The function to call with each block,
+	     *			callable as void(T lo, T hi).
+	     *
+	     * Single-threaded version of parallel for_each_blocked:
+	     * the whole range is one block. The template parameters
+	     * are unused but left for API compatibility.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Iterator, class Last, class Function,
+		     class = typename std::enable_if<!std::is_same<Iterator,Last>::value
+						     && std::is_integral<Iterator>::value
+						     && std::is_integral<Last>::value
+						     >::type
+		     >
+	    typename std::decay<Function>::type
+	    for_each_blocked(Iterator&& first, const Last& last, Function&& fun)
+	    {
+		typedef typename std::common_type<Iterator, Last>::type common_type;
+
+		if (common_type(first) != common_type(last))
+		    fun(common_type(first), common_type(last));
+
+		return std::forward<Function>(fun);
+	    }
+
+	    /**
+	     * Run a function on rectangular tiles of a 2D index range.
+	     *
+	     * @param range
+	     *			The 2D index range to be processed,
+	     *			with an optional tile shape.
+	     *
+	     * @param fun
+	     *			The function to call with each tile,
+	     *			callable as void(T row_begin, T row_end,
+	     *			T col_begin, T col_end).
+	     *
+	     * Single-threaded version of parallel for_each_tiled. The
+	     * range is still visited tile by tile, because the cache
+	     * blocking pays off with one thread too; without a tile
+	     * shape the whole range is one tile. The template
+	     * parameters are unused but left for API compatibility.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     class T, class Function>
+	    typename std::decay<Function>::type
+	    for_each_tiled(const ThreadPoolImpl::impl::Range2D<T>& range, Function&& fun)
+	    {
+		std::size_t tile_rows = range.tile_rows();
+		std::size_t tile_cols = range.tile_cols();
+		if (tile_rows == 0)
+		    tile_rows = range.rows() ? range.rows() : 1;
+		if (tile_cols == 0)
+		    tile_cols = range.cols() ? range.cols() : 1;
+
+		for (T rb = range.row_first(); rb < range.row_last();
+		     rb += static_cast<T>(tile_rows)) {
+		    T re = rb + static_cast<T>(tile_rows);
+		    if (re > range.row_last())
+			re = range.row_last();
+		    for (T cb = range.col_first(); cb < range.col_last();
+			 cb += static_cast<T>(tile_cols)) {
+			T ce = cb + static_cast<T>(tile_cols);
+			if (ce > range.col_last())
+			    ce = range.col_last();
+			fun(rb, re, cb, ce);
+		    }
+		}
+
+		return std::forward<Function>(fun);
+	    }
+
 	    /**
 	     * Run a function on all objects in a container.
 	     *
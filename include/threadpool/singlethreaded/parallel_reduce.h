@@ -0,0 +1,191 @@
+/** @file threadpool/singlethreaded/parallel_reduce.h
+ *
+ * Threadpool for C++11, singlethreaded version of parallel reduce
+ *
+ *
+ * A thread pool interface with single-threaded implementation.
+ * Useful for debugging. Interface identical to the parallel version.
+ * This is used as a fallback implementation on single-threaded
+ * systems. Also useful during debugging.
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_SINGLETHREADED_PARALLEL_REDUCE_H
+#define THREADPOOL_SINGLETHREADED_PARALLEL_REDUCE_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+
+#include "../impl/threadpool_impl_util.h"
+
+namespace threadpool {
+
+    namespace singlethreaded {
+
+	namespace parallel {
+
+
+
+
+
+	    /**
+	     * Reduce a range of iterators to a single value.
+	     *
+	     * @param first
+	     *			The start of the range to be
+	     *			processed.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			processed.
+	     *
+	     * @param init
+	     *			The start value of the accumulation.
+	     *
+	     * @param reduce_fun
+	     *			Binary function folding one element
+	     *			into the accumulator, called as
+	     *			`acc = reduce_fun(std::move(acc), element)`.
+	     *
+	     * @param combine_fun
+	     *			Binary function combining two
+	     *			accumulators, unused in the
+	     *			single-threaded version but left for
+	     *			API compatibility.
+	     *
+	     * @returns
+	     *			The accumulated value
+	     *
+	     * Single-threaded version of parallel reduce. The template
+	     * parameters are unused but left for API compatibility with
+	     * the parallel version.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     class Iterator, class Last, class T,
+		     class Reduce, class Combine,
+		     class = typename std::enable_if<std::is_same<Iterator,Last>::value ||
+						     !std::is_integral<Iterator>::value ||
+						     !std::is_integral<Last>::value
+						     >::type
+		     >
+	    typename std::decay<T>::type
+	    reduce(Iterator first, const Last& last, T&& init,
+		   Reduce&& reduce_fun, Combine&& /*combine_fun*/)
+	    {
+		typename std::decay<T>::type acc(std::forward<T>(init));
+		while (first != last) {
+		    acc = reduce_fun(std::move(acc), *first);
+		    ++first;
+		}
+		return acc;
+	    }
+
+	    /**
+	     * Reduce a range of integral values to a single value.
+	     *
+	     * @param first
+	     *		The start of the range to be processed.
+	     *
+	     * @param last
+	     *		One past the end of the range to be processed.
+	     *
+	     * @param init
+	     *		The start value of the accumulation.
+	     *
+	     * @param reduce_fun
+	     *		Binary function folding one value into the
+	     *		accumulator.
+	     *
+	     * @param combine_fun
+	     *		Unused, left for API compatibility.
+	     *
+	     * Single-threaded version of parallel reduce. The template
+	     * parameters are unused but left for API compatibility with
+	     * the parallel version.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     class Iterator, class Last, class T,
+		     class Reduce, class Combine,
+		     class = typename std::enable_if<!std::is_same<Iterator,Last>::value
+						     && std::is_integral<Iterator>::value
+						     && std::is_integral<Last>::value
+						     >::type
+		     >
+	    typename std::decay<T>::type
+	    reduce(Iterator&& first, const Last& last, T&& init,
+		   Reduce&& reduce_fun, Combine&& combine_fun)
+	    {
+		/*
+		  We can not use the generic function because the user
+		  might specify `first` as 0 which makes type `Iterator'
+		  become `int`, and `last` as something of type
+		  `std::size_t` not representable in an `int`. This loop
+		  would run forever. Just extend type `Iterator`.
+		*/
+		typedef typename std::common_type<Iterator, Last>::type common_type;
+		typedef ThreadPoolImpl::impl::IntegralIterator<common_type> CommonIterator;
+
+		return reduce<thread_count, maxpart
+			      >(CommonIterator(std::forward<Iterator>(first)),
+				CommonIterator(last),
+				std::forward<T>(init),
+				std::forward<Reduce>(reduce_fun),
+				std::forward<Combine>(combine_fun));
+	    }
+
+	    /**
+	     * Reduce all objects in a container to a single value.
+	     *
+	     * @param container
+	     *			The container.
+	     *
+	     * @param init
+	     *			The start value of the accumulation.
+	     *
+	     * @param reduce_fun
+	     *			Binary function folding one element
+	     *			into the accumulator.
+	     *
+	     * @param combine_fun
+	     *			Unused, left for API compatibility.
+	     *
+	     * @returns
+	     *			The accumulated value
+	     *
+	     * Single-threaded version of parallel reduce. The template
+	     * parameters are unused but left for API compatibility with
+	     * the parallel version.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     class Container, class T, class Reduce, class Combine>
+	    typename std::decay<T>::type
+	    reduce(Container&& container, T&& init,
+		   Reduce&& reduce_fun, Combine&& combine_fun)
+	    {
+		return reduce<thread_count, maxpart
+			      >(std::begin(container),
+				std::end(container),
+				std::forward<T>(init),
+				std::forward<Reduce>(reduce_fun),
+				std::forward<Combine>(combine_fun));
+	    }
+
+
+
+
+
+	} // End of namespace parallel
+
+    } // End of namespace singlethreaded
+
+} // End of namespace threadpool
+
+#endif // !defined(THREADPOOL_SINGLETHREADED_PARALLEL_REDUCE_H)
@@ -0,0 +1,132 @@
+/** @file threadpool/singlethreaded/parallel_sort.h
+ *
+ * Threadpool for C++11, singlethreaded version of parallel sort
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_SINGLETHREADED_PARALLEL_SORT_H
+#define THREADPOOL_SINGLETHREADED_PARALLEL_SORT_H
+
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+namespace threadpool {
+
+    namespace singlethreaded {
+
+	namespace parallel {
+
+
+
+
+
+	    /**
+	     * Sort a range of random access iterators.
+	     *
+	     * @param first
+	     *			The start of the range to be sorted.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			sorted.
+	     *
+	     * @param comp
+	     *			The comparison function, a strict weak
+	     *			ordering as for std::sort().
+	     *
+	     * Single-threaded version of parallel_sort, a plain
+	     * std::sort(). The template parameters are unused but left
+	     * for API compatibility with parallel_sort.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Iterator, class Compare>
+	    void sort(Iterator first, Iterator last, Compare comp)
+	    {
+		std::sort(first, last, comp);
+	    }
+
+	    /**
+	     * Sort a range of random access iterators with operator<.
+	     *
+	     * @param first
+	     *			The start of the range to be sorted.
+	     *
+	     * @param last
+	     *			One past the end of the range to be
+	     *			sorted.
+	     *
+	     * Single-threaded version of parallel_sort, a plain
+	     * std::sort(). The template parameters are unused but left
+	     * for API compatibility with parallel_sort.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Iterator>
+	    void sort(Iterator first, Iterator last)
+	    {
+		std::sort(first, last);
+	    }
+
+	    /**
+	     * Sort the objects in a container.
+	     *
+	     * @param container
+	     *			The container, with random access
+	     *			iterators.
+	     *
+	     * @param comp
+	     *			The comparison function, a strict weak
+	     *			ordering as for std::sort().
+	     *
+	     * Single-threaded version of parallel_sort. The template
+	     * parameters are unused but left for API compatibility with
+	     * parallel_sort.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Container, class Compare,
+		     class = decltype(*std::begin(std::declval<Container&>()))>
+	    void sort(Container& container, Compare comp)
+	    {
+		std::sort(std::begin(container), std::end(container),
+			  std::move(comp));
+	    }
+
+	    /**
+	     * Sort the objects in a container with operator<.
+	     *
+	     * @param container
+	     *			The container, with random access
+	     *			iterators.
+	     *
+	     * Single-threaded version of parallel_sort. The template
+	     * parameters are unused but left for API compatibility with
+	     * parallel_sort.
+	     */
+	    template<int thread_count = 1,
+		     std::size_t maxpart = 0,
+		     std::size_t min_chunk = 1,
+		     class Container,
+		     class = decltype(*std::begin(std::declval<Container&>()))>
+	    void sort(Container& container)
+	    {
+		std::sort(std::begin(container), std::end(container));
+	    }
+
+	} // End of namespace parallel
+
+    } // End of namespace singlethreaded
+
+} // End of namespace threadpool
+
+#endif // !defined(THREADPOOL_SINGLETHREADED_PARALLEL_SORT_H)
@@ -11,9 +11,13 @@
 #define THREADPOOL_THREADPOOL_H
 
 #include <cstddef>
+#include <iterator>
 
 #include "threadpool_config.h"
 #include "impl/threadpool_interface_virtual.h"
+#include "impl/threadpool_impl_future.h"
+#include "impl/threadpool_impl_task_group.h"
+#include "impl/threadpool_impl_dependency.h"
 
 
 
@@ -54,41 +58,150 @@ namespace ThreadPoolImpl {
 
 	    typedef VirtualThreadPool_Task Task;
 
+	    /**
+	     * In the exception-free pipeline, reject callables that
+	     * are not noexcept at compile time. Compiles to nothing
+	     * in the default configuration.
+	     */
+	    template<class Function>
+	    static void assert_noexcept_task() {
+#if defined(THREADPOOL_NOEXCEPT_TASKS) && THREADPOOL_NOEXCEPT_TASKS
+		static_assert(noexcept(std::declval<typename std::remove_reference<Function>::type&>()()),
+			      "THREADPOOL_NOEXCEPT_TASKS requires submitted callables to be noexcept");
+#endif
+	    }
+
 
 
 	    explicit VirtualThreadPool(int thread_count = -1,
 				       std::size_t queue_size = 0,
-				       std::size_t maxpart = 1);
+				       std::size_t maxpart = 1,
+				       ThreadOptions thread_options = ThreadOptions());
 
 
 
 	    void run(std::unique_ptr<Task>&& t) override;
 	    void run(Task* t) override;
+	    void run(SmallTask&& t) override;
+	    void run(Priority priority, SmallTask&& t) override;
+	    bool try_run(SmallTask&& t) override;
+	    void notify_when_space(std::function<void()> callback) override;
+	    void run_batch(std::vector<SmallTask>&& batch) override;
+
+	    /**
+	     * Take a snapshot of the pool's runtime statistics:
+	     * queue depth and high-water mark, worker utilization,
+	     * task and wakeup counters, accumulated idle time, and
+	     * a histogram of per-task execution times. Cheap enough
+	     * to poll periodically for autoscaling or monitoring.
+	     */
+	    ThreadPoolStatistics statistics() override;
+
+	    /**
+	     * Number of tasks submitted but not yet finished, whether
+	     * still queued or executing. A single atomic load, cheap
+	     * enough to poll from monitoring threads at any rate.
+	     */
+	    std::size_t pending() override;
+
+
+
+	    /**
+	     * Change the number of worker threads.
+	     *
+	     * Growing spawns the missing workers immediately.
+	     * Shrinking lets the surplus workers retire after they
+	     * have been idle past the idle timeout, and their
+	     * resources are reclaimed by the next resize() or
+	     * join(). Pair with statistics() to scale the pool to
+	     * the observed queue depth instead of hand-tuning a
+	     * fixed thread count per service.
+	     */
+	    void resize(std::size_t thread_count) override;
 
 
 
 	    /**
 	     * Wrap void functions in a task and run them without
-	     * exception handling.
+	     * exception handling. Small closures are stored inline
+	     * in the queue slot and do not touch the heap.
 	     */
 	    template<class Function>
 	    typename std::enable_if<!std::is_pointer<typename std::remove_reference<Function>::type>::value &&
 				    std::is_void<decltype(std::declval<typename std::remove_pointer<typename std::remove_reference<Function>::type>::type>()())>::value
 				    >::type run(Function&& f) {
-	    
-		typedef typename std::remove_reference<Function>::type function_type;
 
-		class WrappedFunction : public Task {
-		    Function f;
-		public:
-		    WrappedFunction(function_type&& f) : f(std::move(f)) { }
-		    virtual void operator()() override {
-			f();
-			delete this;
-		    }
-		};
+		assert_noexcept_task<Function>();
+		run(SmallTask(std::forward<Function>(f)));
+	    }
 
-		run(new WrappedFunction(std::forward<Function>(f)));
+
+
+	    /**
+	     * Run a void function in a specific priority lane.
+	     *
+	     * High-priority tasks overtake queued normal and low
+	     * ones, so one right-sized pool can serve both
+	     * latency-sensitive and bulk work. The plain run()
+	     * overloads use the normal lane.
+	     */
+	    template<class Function>
+	    typename std::enable_if<!std::is_pointer<typename std::remove_reference<Function>::type>::value &&
+				    std::is_void<decltype(std::declval<typename std::remove_pointer<typename std::remove_reference<Function>::type>::type>()())>::value
+				    >::type run(Priority priority, Function&& f) {
+
+		assert_noexcept_task<Function>();
+		run(priority, SmallTask(std::forward<Function>(f)));
+	    }
+
+
+
+	    /**
+	     * Try to run a void function without ever blocking or
+	     * running other tasks on the calling thread.
+	     *
+	     * Returns false and discards the task when the queue is
+	     * at capacity, unlike run(), which would conscript the
+	     * submitter as a helper until space opens up. Meant for
+	     * event-loop threads; pair with notify_when_space() to
+	     * resubmit later.
+	     */
+	    template<class Function>
+	    typename std::enable_if<!std::is_pointer<typename std::remove_reference<Function>::type>::value &&
+				    std::is_void<decltype(std::declval<typename std::remove_pointer<typename std::remove_reference<Function>::type>::type>()())>::value,
+				    bool
+				    >::type try_run(Function&& f) {
+
+		assert_noexcept_task<Function>();
+		return try_run(SmallTask(std::forward<Function>(f)));
+	    }
+
+
+
+	    /**
+	     * Run a batch of void callables.
+	     *
+	     * The whole range is wrapped into tasks and handed to
+	     * the queue in one go, so the queue lock is taken once
+	     * for the batch and the workers are woken once, instead
+	     * of once per task. Worthwhile when many tasks are ready
+	     * for submission at the same time.
+	     *
+	     * @param first
+	     *			Start of the range of callables
+	     *
+	     * @param last
+	     *			End of the range
+	     */
+	    template<class Iterator>
+	    void run_batch(Iterator first, const Iterator& last) {
+		std::vector<SmallTask> batch;
+		batch.reserve(static_cast<std::size_t>(std::distance(first, last)));
+		while (first != last) {
+		    batch.emplace_back(SmallTask(*first));
+		    ++first;
+		}
+		run_batch(std::move(batch));
 	    }
 
 
@@ -121,16 +234,21 @@ namespace ThreadPoolImpl {
 		    }
 
 		    virtual void operator()() override {
+#if defined(THREADPOOL_NOEXCEPT_TASKS) && THREADPOOL_NOEXCEPT_TASKS
+			promise.set_value(f());
+#else
 			try {
 			    promise.set_value(f());
 			} catch (...) {
 			    promise.set_exception(std::current_exception());
 			}
+#endif
 			delete this;
 		    }
 
 		};
 
+		assert_noexcept_task<Function>();
 		WrappedFunction* task(new WrappedFunction(std::forward<Function>(f)));
 		std::future<return_type> future(task->get_future());
 		run(task);
@@ -139,6 +257,72 @@ namespace ThreadPoolImpl {
 
 
 
+	    /**
+	     * Run a function with nonvoid return type and return a
+	     * LightFuture for the result.
+	     *
+	     * Cheaper opt-in alternative to the std::future
+	     * returning run() overload: the shared state is recycled
+	     * from the task arena and completion is signaled with an
+	     * atomic store, so neither submission nor get() touch
+	     * the heap on the fast path. Exceptions from the
+	     * function are rethrown by get(); if the task is
+	     * discarded by join() before it ran, get() throws
+	     * broken_promise.
+	     */
+	    template<class Function>
+	    LightFuture<typename std::result_of<Function()>::type>
+	    run_future(Function&& f) {
+
+		typedef typename std::remove_reference<Function>::type function_type;
+		typedef typename std::result_of<Function()>::type return_type;
+		typedef LightFutureState<return_type> State;
+
+		class FutureTask {
+
+		    function_type f;
+		    State* state;
+
+		public:
+
+		    FutureTask(function_type&& f, State* s) : f(std::move(f)), state(s) { }
+		    FutureTask(function_type& f, State* s) : f(f), state(s) { }
+		    FutureTask(FutureTask&& x) : f(std::move(x.f)), state(x.state) {
+			x.state = nullptr;
+		    }
+
+		    void operator()() {
+			State* s = state;
+			state = nullptr;
+#if defined(THREADPOOL_NOEXCEPT_TASKS) && THREADPOOL_NOEXCEPT_TASKS
+			s->set_value(f());
+#else
+			try {
+			    s->set_value(f());
+			} catch (...) {
+			    s->set_exception(std::current_exception());
+			}
+#endif
+			s->release();
+		    }
+
+		    ~FutureTask() { // Task was discarded without running
+			if (state) {
+			    state->abandon();
+			    state->release();
+			}
+		    }
+		};
+
+		assert_noexcept_task<Function>();
+		State* state = State::create();
+		LightFuture<return_type> future(state);
+		run(SmallTask(FutureTask(std::forward<Function>(f), state)));
+		return future;
+	    }
+
+
+
 	    /**
 	     * Run a function on all objects in an iterator range
 	     *
@@ -277,6 +461,43 @@ namespace threadpool {
      */
     typedef ThreadPoolImpl::impl::VirtualThreadPool<> ThreadPool;
 
+    /**
+     * Worker thread options (CPU pinning, per-worker start
+     * callback), accepted by the ThreadPool constructor.
+     */
+    typedef ThreadPoolImpl::impl::ThreadOptions ThreadOptions;
+
+    /**
+     * Priority lane selector for ThreadPool::run(priority, f).
+     */
+    typedef ThreadPoolImpl::impl::Priority Priority;
+
+    /**
+     * Snapshot of a pool's runtime statistics, returned by
+     * ThreadPool::statistics().
+     */
+    typedef ThreadPoolImpl::impl::ThreadPoolStatistics ThreadPoolStatistics;
+
+    /**
+     * Lightweight future returned by ThreadPool::run_future().
+     */
+    template<class T>
+    using Future = ThreadPoolImpl::impl::LightFuture<T>;
+
+    /**
+     * Scoped wait set: tasks submitted through a TaskGroup can be
+     * waited for independently of everything else on the pool.
+     */
+    typedef ThreadPoolImpl::impl::TaskGroup TaskGroup;
+
+    /**
+     * Dependency-counted scheduling: the successor task is enqueued
+     * when the last of its declared predecessors has finished, so
+     * task graphs run without pool-wide wait() barriers between
+     * phases.
+     */
+    typedef ThreadPoolImpl::impl::Dependency Dependency;
+
     /**
      * Thread pool with template parameters predefining the
      * constructor parameters.
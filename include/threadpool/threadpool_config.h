@@ -14,4 +14,110 @@
 #define THREADPOOL_USE_LIBRARY 0 /// 1 -> use library, 0 -> header-only
 #endif
 
+#ifndef THREADPOOL_USE_TASK_ARENA
+#define THREADPOOL_USE_TASK_ARENA 1 /// 1 -> recycle task blocks, 0 -> plain new/delete
+#endif
+
+#ifndef THREADPOOL_ENABLE_STATISTICS
+#define THREADPOOL_ENABLE_STATISTICS 1 /// 1 -> collect runtime statistics, 0 -> zeroed counters
+#endif
+
+/*
+  1 -> all submitted callables must be noexcept; the try/catch blocks
+  and the pending-exception storage are compiled out of the execution
+  path, worth a few percent on very small tasks. A thrown exception
+  terminates. 0 -> exceptions from tasks are caught and rethrown from
+  wait()/join() as usual.
+*/
+#ifndef THREADPOOL_NOEXCEPT_TASKS
+#define THREADPOOL_NOEXCEPT_TASKS 0
+#endif
+
+/*
+  Default number of pause iterations an idle worker spins before it
+  goes to sleep, hoping to pick up the next task without a futex
+  wake. put() skips the condition-variable notification while a
+  spinner is registered, which saves several microseconds of wakeup
+  latency on sparse workloads. 0 -> pure condition-variable parking
+  (best for batch users who would rather donate the idle cycles).
+  Can also be set per pool by the HQueue constructor.
+*/
+#ifndef THREADPOOL_SPIN_COUNT
+#define THREADPOOL_SPIN_COUNT 1000
+#endif
+
+/*
+  Length in microseconds of the single timed shallow sleep a worker
+  inserts between spinning and deep parking. 0 -> park directly
+  after the spin phase.
+*/
+#ifndef THREADPOOL_SHALLOW_SLEEP_US
+#define THREADPOOL_SHALLOW_SLEEP_US 100
+#endif
+
+/*
+  How long in milliseconds a surplus worker must have been idle
+  before it retires after the pool has been resize()d down. Only
+  relevant once resize() has been called; a pool that is never
+  resized keeps its fixed thread population. Can also be set per
+  pool by the HQueue constructor.
+*/
+#ifndef THREADPOOL_IDLE_TIMEOUT_MS
+#define THREADPOOL_IDLE_TIMEOUT_MS 2000
+#endif
+
+/*
+  1 -> invoke the tracing hook macros below at the task lifecycle
+  points of the queue (enqueue, dequeue, completion, worker
+  idle-begin and idle-end). 0 -> the hooks compile to nothing; none
+  of the hook arguments is evaluated, so a disabled build carries no
+  tracing cost at all.
+*/
+#ifndef THREADPOOL_ENABLE_TRACING
+#define THREADPOOL_ENABLE_TRACING 0
+#endif
+
+#if defined(THREADPOOL_ENABLE_TRACING) && THREADPOOL_ENABLE_TRACING
+
+/*
+  The individual hooks. Define any of them before including a
+  threadpool header to route the events into a tracer; hooks left
+  undefined expand to nothing. The arguments are cheap context that
+  the call sites have at hand anyway:
+
+  - pool	`const void*` identity of the queue, stable for its
+		lifetime, suitable as a correlation key.
+  - worker	`unsigned int` index of the executing worker, unique
+		among the workers of the pool while it lives. The
+		indices of retired workers are reused, and a
+		submitter conscripted as a helper gets a transient
+		index for the duration of its help.
+  - count	`std::size_t`, the number of tasks taken in one
+		dequeue.
+  - depth	`std::size_t`, the queue fill level after the event.
+
+  The enqueue, dequeue and completion hooks are invoked once per
+  put()/chunk grab/executed task respectively; put_batch() fires the
+  enqueue hook once per flushed span. The idle hooks bracket the
+  whole idle phase of a worker, from the start of the spin phase to
+  the wakeup (or retirement), not each parking interval within it.
+*/
+#ifndef THREADPOOL_TRACE_ENQUEUE
+#define THREADPOOL_TRACE_ENQUEUE(pool, depth) ((void)0)
+#endif
+#ifndef THREADPOOL_TRACE_DEQUEUE
+#define THREADPOOL_TRACE_DEQUEUE(pool, worker, count, depth) ((void)0)
+#endif
+#ifndef THREADPOOL_TRACE_COMPLETE
+#define THREADPOOL_TRACE_COMPLETE(pool, worker) ((void)0)
+#endif
+#ifndef THREADPOOL_TRACE_IDLE_BEGIN
+#define THREADPOOL_TRACE_IDLE_BEGIN(pool, worker) ((void)0)
+#endif
+#ifndef THREADPOOL_TRACE_IDLE_END
+#define THREADPOOL_TRACE_IDLE_END(pool, worker) ((void)0)
+#endif
+
+#endif // THREADPOOL_ENABLE_TRACING
+
 #endif // !defined(THREADPOOL_CONFIG_H)
@@ -0,0 +1,310 @@
+/** @file threadpool/threadpool_coroutine.h
+ *
+ * Threadpool for C++11, C++20 coroutine integration
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:58 $
+ */
+#ifndef THREADPOOL_THREADPOOL_COROUTINE_H
+#define THREADPOOL_THREADPOOL_COROUTINE_H
+
+#include "threadpool.h"
+
+/*
+  Awaitable interface to the thread pool for coroutine-based code.
+
+  The callback-style entry points force coroutine users to bridge
+  with std::future::get(), which blocks a whole thread for each
+  pending result. A suspended coroutine frame is much cheaper than a
+  blocked thread, so we offer two awaitables instead:
+
+  - schedule(pool): `co_await schedule(pool)` suspends the current
+    coroutine and resumes it on one of the pool's worker threads.
+
+  - async(pool, fun): runs `fun` on the pool and returns a CoFuture
+    that can be awaited for the result. If the result is not ready
+    yet, the awaiting coroutine is suspended and resumed by the
+    worker thread that completes the task, again without blocking
+    anybody.
+
+  The whole header compiles away to nothing before C++20, so it can
+  be included unconditionally next to threadpool.h; user code tests
+  THREADPOOL_HAVE_COROUTINES.
+*/
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902 \
+    && defined(__has_include) && __has_include(<coroutine>)
+
+#define THREADPOOL_HAVE_COROUTINES 1
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ThreadPoolImpl {
+
+    namespace impl {
+
+	/**
+	 * Awaitable that reschedules the awaiting coroutine onto a
+	 * worker thread of the pool.
+	 *
+	 * The coroutine handle is wrapped into a small task, so the
+	 * suspension costs one queue slot and no heap allocation.
+	 */
+	template<int I>
+	class ScheduleAwaiter {
+
+	    VirtualThreadPool<I>& pool;
+
+	public:
+
+	    explicit ScheduleAwaiter(VirtualThreadPool<I>& pool)
+		: pool(pool) { }
+
+	    bool await_ready() const noexcept { return false; }
+
+	    void await_suspend(std::coroutine_handle<> handle) {
+		pool.run([handle]{ handle.resume(); });
+	    }
+
+	    void await_resume() const noexcept { }
+	};
+
+	/**
+	 * Result type of invoking a callable, C++20 spelling
+	 * (std::result_of is gone there).
+	 */
+	template<class Function>
+	using co_result_t =
+	    std::invoke_result_t<std::remove_reference_t<Function>&>;
+
+	/**
+	 * Shared state between a task running on the pool and the
+	 * coroutine awaiting its result.
+	 *
+	 * The `waiter` pointer serves as the whole state machine:
+	 * null means pending, the address of the state itself is the
+	 * ready marker, and anything else is the handle of a
+	 * suspended coroutine. Producer and consumer race on it with
+	 * one exchange/compare-exchange each, so whichever side
+	 * comes second resumes the continuation.
+	 *
+	 * Reference-counted because the task and the future go
+	 * separate ways; the count starts at 2.
+	 */
+	template<class T>
+	class CoState {
+
+	    std::atomic<void*> waiter;
+	    std::atomic<unsigned int> refs;
+	    std::exception_ptr exception;
+	    typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+	    bool has_value;
+
+	public:
+
+	    CoState() : waiter(nullptr), refs(2), has_value(false) { }
+
+	    void set_value(T&& v) {
+		new (&value) T(std::move(v));
+		has_value = true;
+	    }
+
+	    void set_exception(std::exception_ptr e) {
+		exception = std::move(e);
+	    }
+
+	    /**
+	     * Mark the result ready. If a coroutine is already
+	     * suspended on us, resume it right here on the worker
+	     * thread.
+	     */
+	    void complete() {
+		void* w = waiter.exchange(this, std::memory_order_acq_rel);
+		if (w)
+		    std::coroutine_handle<>::from_address(w).resume();
+	    }
+
+	    bool ready() const {
+		return waiter.load(std::memory_order_acquire) == this;
+	    }
+
+	    /**
+	     * Called from await_suspend(). Returns false if the
+	     * result raced in first and the coroutine should just
+	     * continue.
+	     */
+	    bool park(std::coroutine_handle<> handle) {
+		void* expected = nullptr;
+		return waiter.compare_exchange_strong(expected, handle.address(),
+						      std::memory_order_acq_rel);
+	    }
+
+	    T get() {
+		if (exception)
+		    std::rethrow_exception(exception);
+		return std::move(*reinterpret_cast<T*>(&value));
+	    }
+
+	    void release() {
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		    if (has_value)
+			reinterpret_cast<T*>(&value)->~T();
+		    delete this;
+		}
+	    }
+	};
+
+	/**
+	 * Awaitable future for a result computed on the pool.
+	 *
+	 * Returned by co_async(). Await it exactly once; the await
+	 * either returns immediately when the result is already
+	 * there, or suspends the coroutine until the worker thread
+	 * completing the task resumes it. get() semantics match
+	 * LightFuture: the value is moved out, exceptions from the
+	 * task are rethrown.
+	 */
+	template<class T>
+	class CoFuture {
+
+	    CoState<T>* state;
+
+	public:
+
+	    explicit CoFuture(CoState<T>* state) : state(state) { }
+
+	    CoFuture(CoFuture&& x) : state(x.state) { x.state = nullptr; }
+
+	    CoFuture(const CoFuture&) = delete;
+	    CoFuture& operator=(const CoFuture&) = delete;
+
+	    ~CoFuture() {
+		if (state)
+		    state->release();
+	    }
+
+	    bool await_ready() const noexcept { return state->ready(); }
+
+	    bool await_suspend(std::coroutine_handle<> handle) {
+		return state->park(handle);
+	    }
+
+	    T await_resume() { return state->get(); }
+	};
+
+	/**
+	 * Run a function on the pool and return an awaitable
+	 * CoFuture for its result.
+	 */
+	template<int I, class Function>
+	CoFuture<co_result_t<Function>>
+	co_async(VirtualThreadPool<I>& pool, Function&& fun) {
+
+	    typedef typename std::remove_reference<Function>::type function_type;
+	    typedef co_result_t<Function> return_type;
+	    typedef CoState<return_type> State;
+
+	    State* state = new State;
+	    CoFuture<return_type> future(state);
+
+	    class CoTask {
+
+		function_type f;
+		State* state;
+
+	    public:
+
+		CoTask(function_type&& f, State* s) : f(std::move(f)), state(s) { }
+		CoTask(function_type& f, State* s) : f(f), state(s) { }
+		CoTask(CoTask&& x) : f(std::move(x.f)), state(x.state) {
+		    x.state = nullptr;
+		}
+
+		void operator()() {
+		    State* s = state;
+		    state = nullptr;
+		    try {
+			s->set_value(f());
+		    } catch (...) {
+			s->set_exception(std::current_exception());
+		    }
+		    s->complete();
+		    s->release();
+		}
+
+		~CoTask() { // Task was discarded without running
+		    if (state) {
+			state->set_exception(
+			    std::make_exception_ptr(
+				std::future_error(std::future_errc::broken_promise)));
+			state->complete();
+			state->release();
+		    }
+		}
+	    };
+
+	    pool.run(SmallTask(CoTask(std::forward<Function>(fun), state)));
+	    return future;
+	}
+
+    } // End of namespace impl
+
+} // End of namespace ThreadPoolImpl
+
+
+
+
+
+/*
+  Export exported symbols to namespace `threadpool`.
+*/
+namespace threadpool {
+
+    /**
+     * Awaitable future returned by async().
+     */
+    template<class T>
+    using CoFuture = ThreadPoolImpl::impl::CoFuture<T>;
+
+    /**
+     * `co_await schedule(pool)` hops the current coroutine onto a
+     * worker thread of the pool.
+     */
+    inline ThreadPoolImpl::impl::ScheduleAwaiter<0>
+    schedule(ThreadPool& pool) {
+	return ThreadPoolImpl::impl::ScheduleAwaiter<0>(pool);
+    }
+
+    /**
+     * Run a function with nonvoid return type on the pool and
+     * return an awaitable CoFuture for the result. The awaiting
+     * coroutine is resumed by the worker thread that completes the
+     * task instead of blocking a thread in std::future::get().
+     */
+    template<class Function>
+    CoFuture<ThreadPoolImpl::impl::co_result_t<Function>>
+    async(ThreadPool& pool, Function&& fun) {
+	return ThreadPoolImpl::impl::co_async(pool, std::forward<Function>(fun));
+    }
+
+} // End of namespace threadpool
+
+#else // No C++20 coroutine support, everything compiles away
+
+#define THREADPOOL_HAVE_COROUTINES 0
+
+#endif
+
+
+
+
+
+#endif // !defined(THREADPOOL_THREADPOOL_COROUTINE_H)
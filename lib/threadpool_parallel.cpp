@@ -0,0 +1,20 @@
+/** @file lib/threadpool_parallel.cpp
+ *
+ * Threadpool for C++11, library version of the parallel algorithm driver
+ *
+ * @copyright	2014 Ruediger Helsch, Ruediger.Helsch@t-online.de
+ * @license	All rights reserved. Use however you want. No warranty at all.
+ * $Revision: 2.0 $
+ * $Date: 2014/05/14 16:56:59 $
+ */
+#define THREADPOOL_USE_LIBRARY 1
+
+#include "threadpool/impl/threadpool_impl_drive_inst.h"
+
+namespace ThreadPoolImpl {
+    namespace impl {
+
+	template class ParallelDriveTmpl<>;
+
+    }
+}
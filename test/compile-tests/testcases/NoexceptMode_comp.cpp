@@ -0,0 +1,13 @@
+#include <ostream>
+#include <iostream>
+#define THREADPOOL_NOEXCEPT_TASKS 1
+#include "threadpool/threadpool.h"
+
+int main() {
+    threadpool::ThreadPool pool;
+    auto f = pool.run([]() noexcept { return 21; });
+    pool.run([]() noexcept { });
+    pool.wait();
+    if (f.get() == 21)
+	std::cerr << "PASS" << std::endl;
+}
@@ -0,0 +1,14 @@
+#include <ostream>
+#include <iostream>
+#define THREADPOOL_SPIN_COUNT 0
+#define THREADPOOL_SHALLOW_SLEEP_US 0
+#include "threadpool/threadpool.h"
+
+int main() {
+    threadpool::ThreadPool pool;
+    auto f = pool.run([]() { return 21; });
+    pool.run([]() { });
+    pool.wait();
+    if (f.get() == 21)
+	std::cerr << "PASS" << std::endl;
+}
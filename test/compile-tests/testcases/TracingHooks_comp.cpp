@@ -0,0 +1,49 @@
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <iostream>
+
+std::atomic<unsigned long long> enqueued(0);
+std::atomic<unsigned long long> dequeued(0);
+std::atomic<unsigned long long> completed(0);
+std::atomic<unsigned long long> idle_begins(0);
+std::atomic<unsigned long long> idle_ends(0);
+
+#define THREADPOOL_ENABLE_TRACING 1
+#define THREADPOOL_TRACE_ENQUEUE(pool, depth) \
+    ((void)(pool), (void)(depth), ++enqueued)
+#define THREADPOOL_TRACE_DEQUEUE(pool, worker, count, depth) \
+    ((void)(pool), (void)(worker), (void)(depth), dequeued += (count))
+#define THREADPOOL_TRACE_COMPLETE(pool, worker) \
+    ((void)(pool), (void)(worker), ++completed)
+#define THREADPOOL_TRACE_IDLE_BEGIN(pool, worker) \
+    ((void)(pool), (void)(worker), ++idle_begins)
+#define THREADPOOL_TRACE_IDLE_END(pool, worker) \
+    ((void)(pool), (void)(worker), ++idle_ends)
+#include "threadpool/threadpool.h"
+
+int main() {
+    const int n = 100;
+    std::atomic<int> sum(0);
+    {
+	threadpool::ThreadPool pool(2);
+	for (int i = 0; i < n; ++i)
+	    pool.run([&sum]() { ++sum; });
+	pool.wait();
+    } // Destructor joins; all workers have left their idle phases
+
+    if (sum == n
+	&& enqueued == static_cast<unsigned long long>(n)
+	&& dequeued == static_cast<unsigned long long>(n)
+	&& completed == static_cast<unsigned long long>(n)
+	&& idle_begins == idle_ends)
+	std::cerr << "PASS" << std::endl;
+    else {
+	std::cerr << "FAIL: enqueued " << enqueued
+		  << ", dequeued " << dequeued
+		  << ", completed " << completed
+		  << ", idle_begins " << idle_begins
+		  << ", idle_ends " << idle_ends << std::endl;
+	return 1;
+    }
+}
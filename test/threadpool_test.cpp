@@ -10,10 +10,12 @@
 #define BOOST_TEST_MODULE threadpool_test
 #include <vector>
 #include <list>
+#include <array>
 #include <ostream>
 #include <iostream>
 #include <chrono>
 #include <cmath>
+#include <algorithm>
 #include <iterator>
 #define BOOST_TEST_MAIN
 
@@ -57,19 +59,45 @@ namespace test_tools {
 #include <boost/test/included/unit_test.hpp>
 using boost::unit_test::test_suite;
 
+/*
+  Newer Boost.Test versions no longer find the operator<< above through
+  its print helpers. Specialize print_log_value to route through it.
+*/
+namespace boost { namespace test_tools { namespace tt_detail {
+
+    template<typename T>
+    struct print_log_value<std::vector<T> > {
+	void operator()(std::ostream& s, const std::vector<T>& r) {
+	    boost::test_tools::operator<<(s, r);
+	}
+    };
+
+}}}
+
 
 
 
 
 #include "../include/threadpool/threadpool.h"
+#include "../include/threadpool/threadpool_coroutine.h"
+#include "../include/threadpool/pipeline.h"
 #include "../include/threadpool/parallel_for_each.h"
+#include "../include/threadpool/parallel_reduce.h"
+#include "../include/threadpool/parallel_sort.h"
 #include "../include/threadpool/parallel_transform.h"
 #include "../include/threadpool/singlethreaded/threadpool.h"
 #include "../include/threadpool/singlethreaded/parallel_for_each.h"
+#include "../include/threadpool/singlethreaded/parallel_reduce.h"
+#include "../include/threadpool/singlethreaded/parallel_sort.h"
 #include "../include/threadpool/singlethreaded/parallel_transform.h"
 #include "../include/threadpool/make_iterator.h"
+#include "../include/threadpool/executor.h"
 
 #include "../include/threadpool/impl/threadpool_impl_homogenous.h"
+#include "../include/threadpool/impl/threadpool_impl_lockfree.h"
+#include "../include/threadpool/impl/threadpool_impl_workstealing.h"
+#include "../include/threadpool/impl/threadpool_impl_singleproducer.h"
+#include "../include/threadpool/impl/threadpool_impl_numa.h"
 
 
 
@@ -619,6 +647,703 @@ namespace threadpool_test {
 	for_each_tests<singlethreaded_for_each_tests_helper>();
     }
 
+    BOOST_AUTO_TEST_CASE(for_each_blocked_tests)
+    {
+	{ // Iterator form: every element covered exactly once
+	    std::vector<std::atomic<int> > v(10000);
+	    for (auto& e: v)
+		e.store(0);
+	    threadpool::parallel::for_each_blocked<4>(
+		v.begin(), v.end(),
+		[](std::vector<std::atomic<int> >::iterator b,
+		   std::vector<std::atomic<int> >::iterator e) {
+		    while (b != e)
+			++*b++;
+		});
+	    for (auto& e: v)
+		BOOST_CHECK_EQUAL(e.load(), 1);
+	}
+	{ // Integral form: the kernel loops over [lo, hi) itself
+	    std::vector<int> vo(10000, 0);
+	    threadpool::parallel::for_each_blocked<4, 1000, 64>(
+		0, vo.size(), [&vo](int lo, int hi) {
+		    for (int i = lo; i < hi; ++i)
+			vo[i] = 3 * i;
+		});
+	    for (int i = 0; i < (int)vo.size(); ++i)
+		BOOST_CHECK_EQUAL(vo[i], 3 * i);
+	}
+	{ // Singlethreaded fallback: one block for the whole range
+	    std::vector<int> vo(100, 0);
+	    int calls = 0;
+	    threadpool::singlethreaded::parallel::for_each_blocked(
+		0, vo.size(), [&vo, &calls](int lo, int hi) {
+		    ++calls;
+		    for (int i = lo; i < hi; ++i)
+			vo[i] = i;
+		});
+	    BOOST_CHECK_EQUAL(calls, 1);
+	    for (int i = 0; i < (int)vo.size(); ++i)
+		BOOST_CHECK_EQUAL(vo[i], i);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(function_input_pull_tests)
+    {
+	{ // Direct pull(): block fetch, short count at the end
+	    int u = 0;
+	    auto r = threadpool::make_function_input_range([&u]() -> int {
+		    if (u == 10)
+			throw std::out_of_range("");
+		    return u++;
+		});
+	    auto it = r.begin();
+	    std::vector<int> buf;
+	    BOOST_CHECK_EQUAL(it.pull(buf, 4), 4);
+	    BOOST_CHECK_EQUAL(it.pull(buf, 100), 6);
+	    BOOST_CHECK_EQUAL(it.pull(buf, 100), 0);
+	    BOOST_CHECK_EQUAL(buf.size(), 10);
+	    for (int i = 0; i < 10; ++i)
+		BOOST_CHECK_EQUAL(buf[i], i);
+	    BOOST_CHECK_EQUAL(r.end().pull(buf, 1), 0);
+	}
+	{ // pull() delivers the value cached by a comparison first
+	    int u = 0;
+	    auto r = threadpool::make_function_input_range([&u]() -> int {
+		    if (u == 3)
+			throw std::out_of_range("");
+		    return u++;
+		});
+	    auto it = r.begin();
+	    BOOST_CHECK(it != r.end()); // Probes and caches one value
+	    std::vector<int> buf;
+	    BOOST_CHECK_EQUAL(it.pull(buf, 100), 3);
+	    CONTAINER_CHECK_EQUAL(buf, ({0,1,2}));
+	}
+	{ // Multithreaded for_each over a generator: each value once
+	    const int n = 10000;
+	    std::vector<std::atomic<int> > seen(n);
+	    for (auto& e: seen)
+		e.store(0);
+	    int u = 0;
+	    threadpool::parallel::for_each<4>(
+		threadpool::make_function_input_range([&u]() -> int {
+			if (u == n)
+			    throw std::out_of_range("");
+			return u++;
+		    }),
+		[&seen](int i) { ++seen[i]; });
+	    for (auto& e: seen)
+		BOOST_CHECK_EQUAL(e.load(), 1);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(for_each_tiled_tests)
+    {
+	typedef threadpool::parallel::Range2D<int> Range2D;
+	{ // Every cell covered exactly once, default tile shape
+	    const int rows = 120, cols = 80;
+	    std::vector<std::atomic<int> > cells(rows * cols);
+	    for (auto& e: cells)
+		e.store(0);
+	    threadpool::parallel::for_each_tiled<4>(
+		Range2D(0, rows, 0, cols),
+		[&cells](int rb, int re, int cb, int ce) {
+		    for (int r = rb; r < re; ++r)
+			for (int c = cb; c < ce; ++c)
+			    ++cells[r * cols + c];
+		});
+	    for (auto& e: cells)
+		BOOST_CHECK_EQUAL(e.load(), 1);
+	}
+	{ // An explicit tile shape bounds every call
+	    const int rows = 100, cols = 70;
+	    std::atomic<int> cells(0);
+	    std::atomic<bool> shape_ok(true);
+	    threadpool::parallel::for_each_tiled<4>(
+		Range2D(0, rows, 0, cols, 32, 16),
+		[&cells, &shape_ok](int rb, int re, int cb, int ce) {
+		    if (re - rb > 32 || ce - cb > 16)
+			shape_ok.store(false);
+		    cells += (re - rb) * (ce - cb);
+		});
+	    BOOST_CHECK(shape_ok.load());
+	    BOOST_CHECK_EQUAL(cells.load(), rows * cols);
+	}
+	{ // Offset bounds are passed through to the kernel
+	    std::atomic<long> sum(0);
+	    threadpool::parallel::for_each_tiled<4>(
+		Range2D(10, 20, 100, 110, 3, 3),
+		[&sum](int rb, int re, int cb, int ce) {
+		    for (int r = rb; r < re; ++r)
+			for (int c = cb; c < ce; ++c)
+			    sum += r * 1000 + c;
+		});
+	    long expected = 0;
+	    for (int r = 10; r < 20; ++r)
+		for (int c = 100; c < 110; ++c)
+		    expected += r * 1000 + c;
+	    BOOST_CHECK_EQUAL(sum.load(), expected);
+	}
+	{ // Empty range calls the kernel never
+	    int calls = 0;
+	    threadpool::parallel::for_each_tiled<4>(
+		Range2D(5, 5, 0, 10),
+		[&calls](int, int, int, int) { ++calls; });
+	    BOOST_CHECK_EQUAL(calls, 0);
+	}
+	{ // Singlethreaded fallback still visits tile by tile
+	    const int rows = 8, cols = 8;
+	    std::vector<int> cells(rows * cols, 0);
+	    int calls = 0;
+	    threadpool::singlethreaded::parallel::for_each_tiled(
+		Range2D(0, rows, 0, cols, 4, 4),
+		[&cells, &calls](int rb, int re, int cb, int ce) {
+		    ++calls;
+		    for (int r = rb; r < re; ++r)
+			for (int c = cb; c < ce; ++c)
+			    ++cells[r * cols + c];
+		});
+	    BOOST_CHECK_EQUAL(calls, 4);
+	    for (auto& e: cells)
+		BOOST_CHECK_EQUAL(e, 1);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(guided_scheduling_tests)
+    {
+	{ // Explicit minimum chunk on the iterator algorithm
+	    std::vector<std::atomic<int> > v(10000);
+	    for (auto& e: v)
+		e.store(0);
+	    threadpool::parallel::for_each<4, 1000, 64>(v, [](std::atomic<int>& e){ ++e; });
+	    for (auto& e: v)
+		BOOST_CHECK_EQUAL(e.load(), 1);
+	}
+	{ // Minimum stride on the homogenous queue
+	    std::atomic<int> count(0);
+	    {
+		ThreadPoolImpl::impl::HQueue<std::function<void()> > queue(0, 5, 32);
+		ThreadPoolImpl::impl::GenericThreadPool pool(queue, 4);
+		for (int i = 0; i < 10000; ++i)
+		    queue.put([&count](){ ++count; });
+		queue.wait();
+		queue.shutdown();
+		pool.join();
+	    }
+	    BOOST_CHECK_EQUAL(count.load(), 10000);
+	}
+    }
+
+    // Not default-constructible and not copyable, so any pre-sizing
+    // or per-element copy in transform_into() would fail to compile.
+    struct EmplacedResult {
+	int value;
+	explicit EmplacedResult(int value) : value(value) { }
+	EmplacedResult(const EmplacedResult&) = delete;
+	EmplacedResult(EmplacedResult&& x) : value(x.value) { }
+    };
+
+    BOOST_AUTO_TEST_CASE(transform_into_tests)
+    {
+	{ // Results constructed in place, in input order
+	    std::vector<int> a(1000);
+	    for (int i = 0; i != 1000; ++i)
+		a[i] = i;
+	    std::vector<EmplacedResult> r;
+	    threadpool::parallel::transform_into<4>(a, r,
+		[](int e) { return EmplacedResult(2 * e); });
+	    BOOST_CHECK_EQUAL(r.size(), a.size());
+	    for (int i = 0; i != 1000; ++i)
+		BOOST_CHECK_EQUAL(r[i].value, 2 * i);
+	}
+	{ // Integral range, reserved once up front
+	    std::vector<int> r;
+	    threadpool::parallel::transform_into<4>(0, std::size_t(500), r,
+		[](int e) { return e + 1; });
+	    BOOST_CHECK_EQUAL(r.size(), 500u);
+	    BOOST_CHECK(r.capacity() >= 500u);
+	    for (int i = 0; i != 500; ++i)
+		BOOST_CHECK_EQUAL(r[i], i + 1);
+	}
+	{ // Containers without reserve() still work
+	    std::vector<int> a({1, 2, 3, 4, 5});
+	    std::list<int> r;
+	    threadpool::parallel::transform_into<4>(a, r,
+		[](int e) { return 3 * e; });
+	    BOOST_CHECK_EQUAL(r.size(), a.size());
+	    int i = 0;
+	    for (int e: r)
+		BOOST_CHECK_EQUAL(e, 3 * a[i++]);
+	}
+	{ // The emplace iterator stands on its own as well
+	    std::vector<EmplacedResult> r;
+	    auto out = threadpool::make_emplace_iterator(r);
+	    *out = 7;
+	    ++out;
+	    *out = EmplacedResult(8);
+	    BOOST_CHECK_EQUAL(r.size(), 2u);
+	    BOOST_CHECK_EQUAL(r[0].value, 7);
+	    BOOST_CHECK_EQUAL(r[1].value, 8);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(segmented_queue_tests)
+    {
+	{ // A huge capacity bound does not preallocate huge storage
+	    ThreadPoolImpl::impl::HQueue<std::function<void()> > queue(1000000, 3);
+	    ThreadPoolImpl::impl::GenericThreadPool pool(queue, 2);
+	    std::atomic<int> count(0);
+	    for (int round = 0; round < 3; ++round) { // Grow, drain, reuse
+		for (int i = 0; i < 5000; ++i)
+		    queue.put([&count](){ ++count; });
+		queue.wait();
+	    }
+	    queue.shutdown();
+	    pool.join();
+	    BOOST_CHECK_EQUAL(count.load(), 15000);
+	}
+	{ // Wrap around the segment ring many times with a tiny bound
+	    std::atomic<int> count(0);
+	    {
+		threadpool::ThreadPool pool(2, 3);
+		for (int i = 0; i < 1000; ++i)
+		    pool.run([&count](){ ++count; });
+	    }
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(resize_tests)
+    {
+	{ // Growing spawns workers that pick up queued tasks
+	    threadpool::ThreadPool pool(2, 1000, 3);
+	    pool.resize(4);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 1000; ++i)
+		pool.run([&count](){ ++count; });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	    for (int i = 0; i < 500 && pool.statistics().total_workers != 4; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	    BOOST_CHECK_EQUAL(pool.statistics().total_workers, 4u);
+	}
+	{ // Shrinking retires the surplus workers after the idle timeout
+	    ThreadPoolImpl::impl::HQueue<std::function<void()> > queue(
+		1000, 3, 1, 0 /* spin_count */, 20 /* idle_timeout_ms */);
+	    ThreadPoolImpl::impl::GenericThreadPool pool(queue, 4);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 1000; ++i)
+		queue.put([&count](){ ++count; });
+	    queue.wait();
+	    pool.resize(1);
+	    for (int i = 0; i < 500 && queue.statistics().total_workers != 1; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	    BOOST_CHECK_EQUAL(queue.statistics().total_workers, 1u);
+	    // Let the retired threads finish unwinding before they are reaped
+	    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	    pool.resize(3); // Growing again respawns workers
+	    for (int i = 0; i < 1000; ++i)
+		queue.put([&count](){ ++count; });
+	    queue.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 2000);
+	    for (int i = 0; i < 500 && queue.statistics().total_workers != 3; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	    BOOST_CHECK_EQUAL(queue.statistics().total_workers, 3u);
+	    queue.shutdown();
+	    pool.join();
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(priority_tests)
+    {
+	{ // High overtakes queued normal and low work
+	    threadpool::ThreadPool pool(1);
+	    std::mutex gate; // Holds the single worker on a blocker task
+	    gate.lock();
+	    std::vector<int> order;
+	    std::atomic<int> done(0);
+	    auto record = [&order, &done](int id) {
+		order.push_back(id);
+		++done;
+	    };
+	    pool.run([&gate]{ gate.lock(); gate.unlock(); });
+	    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	    pool.run(threadpool::Priority::low, [record]{ record(3); });
+	    pool.run([record]{ record(2); }); // Normal lane
+	    pool.run(threadpool::Priority::high, [record]{ record(1); });
+	    gate.unlock();
+	    while (done.load() != 3)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    pool.wait();
+	    BOOST_REQUIRE_EQUAL(order.size(), 3u);
+	    BOOST_CHECK_EQUAL(order[0], 1);
+	    BOOST_CHECK_EQUAL(order[1], 2);
+	    BOOST_CHECK_EQUAL(order[2], 3);
+	}
+	{ // The starvation guard lets low work through a high burst
+	    threadpool::ThreadPool pool(1);
+	    std::mutex gate;
+	    gate.lock();
+	    std::vector<int> order;
+	    std::atomic<int> done(0);
+	    pool.run([&gate]{ gate.lock(); gate.unlock(); });
+	    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	    pool.run(threadpool::Priority::low, [&order, &done]{
+		    order.push_back(-1);
+		    ++done;
+		});
+	    for (int i = 0; i < 40; ++i)
+		pool.run(threadpool::Priority::high, [&order, &done, i]{
+			order.push_back(i);
+			++done;
+		    });
+	    gate.unlock();
+	    while (done.load() != 41)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    pool.wait();
+	    BOOST_REQUIRE_EQUAL(order.size(), 41u);
+	    std::size_t low_pos = 0;
+	    while (order[low_pos] != -1)
+		++low_pos;
+	    BOOST_CHECK_LT(low_pos, 40u); // Did not run last
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(try_run_tests)
+    {
+	threadpool::ThreadPool pool(1, 2);
+	std::mutex gate; // Holds the single worker on a blocker task
+	gate.lock();
+	std::atomic<int> ran(0);
+	pool.run([&gate, &ran]{ gate.lock(); gate.unlock(); ++ran; });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	// Fill the queue without ever blocking the submitter
+	int accepted = 0;
+	while (pool.try_run([&ran]{ ++ran; }))
+	    ++accepted;
+	BOOST_CHECK_EQUAL(accepted, 2);
+
+	// Full: the callback must be deferred until space opens up
+	std::atomic<bool> notified(false);
+	pool.notify_when_space([&notified]{ notified = true; });
+	BOOST_CHECK(!notified.load());
+	gate.unlock();
+	while (!notified.load())
+	    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	BOOST_CHECK(pool.try_run([&ran]{ ++ran; }));
+	pool.wait();
+	BOOST_CHECK_EQUAL(ran.load(), accepted + 2);
+
+	// Not full: the callback is invoked immediately
+	std::atomic<bool> immediate(false);
+	pool.notify_when_space([&immediate]{ immediate = true; });
+	BOOST_CHECK(immediate.load());
+    }
+
+    BOOST_AUTO_TEST_CASE(task_group_tests)
+    {
+	{ // Groups wait independently on a shared pool
+	    threadpool::ThreadPool pool(2);
+	    threadpool::TaskGroup slow(pool);
+	    threadpool::TaskGroup fast(pool);
+	    std::mutex gate; // Holds the slow group's task
+	    gate.lock();
+	    std::atomic<bool> slow_done(false);
+	    slow.run([&gate, &slow_done]{ gate.lock(); gate.unlock(); slow_done = true; });
+	    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 100; ++i)
+		fast.run([&count]{ ++count; });
+	    fast.wait(); // Must not wait for the blocked slow task
+	    BOOST_CHECK_EQUAL(count.load(), 100);
+	    BOOST_CHECK(!slow_done.load());
+	    gate.unlock();
+	    slow.wait();
+	    BOOST_CHECK(slow_done.load());
+	    pool.wait();
+	}
+	{ // Exceptions are routed per group
+	    threadpool::ThreadPool pool(2);
+	    threadpool::TaskGroup good(pool);
+	    threadpool::TaskGroup bad(pool);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 10; ++i)
+		good.run([&count]{ ++count; });
+	    bad.run([]{ throw std::runtime_error("group"); });
+	    BOOST_CHECK_THROW(bad.wait(), std::runtime_error);
+	    good.wait(); // Unaffected by the other group's failure
+	    BOOST_CHECK_EQUAL(count.load(), 10);
+	    pool.run([&count]{ ++count; }); // The pool stays healthy
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 11);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(pipeline_tests)
+    {
+	{ // Three stages, each item passing through all of them
+	    std::atomic<long> sum(0);
+	    auto p = threadpool::make_pipeline<int>(
+		threadpool::stage(2, [](int x) { return x * 2; }),
+		threadpool::stage(2, [](int x) { return x + 1; }),
+		threadpool::stage(1, [&sum](int x) { sum += x; }));
+	    for (int i = 0; i < 1000; ++i)
+		p->push(i);
+	    p->wait();
+	    BOOST_CHECK_EQUAL(sum.load(), 1000000l);
+	}
+	{ // Move-only items travel from stage to stage
+	    std::atomic<long> sum(0);
+	    auto p = threadpool::make_pipeline<std::unique_ptr<int> >(
+		threadpool::stage(2, [](std::unique_ptr<int> x) {
+			*x *= 3;
+			return x;
+		    }),
+		threadpool::stage(1, [&sum](std::unique_ptr<int> x) {
+			sum += *x;
+		    }));
+	    for (int i = 1; i <= 100; ++i)
+		p->push(std::unique_ptr<int>(new int(i)));
+	    p->wait();
+	    BOOST_CHECK_EQUAL(sum.load(), 3l * 5050);
+	}
+	{ // Tiny inter-stage queues exercise the backpressure path
+	    std::atomic<int> count(0);
+	    auto p = threadpool::make_pipeline<int>(
+		threadpool::stage(1, [](int x) { return x; }, 2),
+		threadpool::stage(1, [&count](int) { ++count; }, 2));
+	    for (int i = 0; i < 200; ++i)
+		p->push(i);
+	    p->wait();
+	    BOOST_CHECK_EQUAL(count.load(), 200);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(shared_pool_tests)
+    {
+	{ // Many small calls, all borrowing the shared pool
+	    std::vector<std::atomic<int> > v(100);
+	    for (auto& e: v)
+		e.store(0);
+	    for (int i = 0; i < 100; ++i)
+		threadpool::parallel::for_each(v, [](std::atomic<int>& e){ ++e; });
+	    for (auto& e: v)
+		BOOST_CHECK_EQUAL(e.load(), 100);
+	}
+	{ // A failing call must not poison the shared pool
+	    std::vector<int> v(1000, 1);
+	    BOOST_CHECK_THROW(threadpool::parallel::for_each(v, [](int&){
+			throw std::runtime_error("x");
+		    }), std::runtime_error);
+	    std::atomic<int> count(0);
+	    threadpool::parallel::for_each(v, [&count](int& e){ count += e; });
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+	{ // The shared pool can also be used directly
+	    std::atomic<int> count(0);
+	    threadpool::parallel::shared_pool().run([&count](){ ++count; });
+	    threadpool::parallel::shared_pool().wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1);
+	}
+	{ // Exercise the borrowed-worker driver directly, since the
+	  // free functions fall back to the singlethreaded algorithm
+	  // when only one hardware thread is visible.
+	    std::vector<int> v(10000, 0);
+	    auto fun = [](int& e){ ++e; };
+	    auto first = v.begin();
+	    auto last = v.end();
+	    typedef ThreadPoolImpl::impl::ForEachThreadPoolImpl<std::vector<int>::iterator,
+								std::vector<int>::iterator,
+								decltype(fun)> Impl;
+	    Impl::Queue queue(first, last, fun, 12);
+	    ThreadPoolImpl::impl::run_on_shared_pool(queue, 4);
+	    for (int e: v)
+		BOOST_CHECK_EQUAL(e, 1);
+	}
+	{ // A throwing queue is rethrown here, not into the pool
+	    std::vector<int> v(100, 0);
+	    auto fun = [](int&) -> void { throw std::runtime_error("x"); };
+	    auto first = v.begin();
+	    auto last = v.end();
+	    typedef ThreadPoolImpl::impl::ForEachThreadPoolImpl<std::vector<int>::iterator,
+								std::vector<int>::iterator,
+								decltype(fun)> Impl;
+	    Impl::Queue queue(first, last, fun, 12);
+	    BOOST_CHECK_THROW(ThreadPoolImpl::impl::run_on_shared_pool(queue, 4),
+			      std::runtime_error);
+	    std::atomic<int> count(0);
+	    threadpool::parallel::shared_pool().run([&count](){ ++count; });
+	    threadpool::parallel::shared_pool().wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1);
+	}
+	{ // An explicit thread count still gets a dedicated pool
+	    std::vector<int> v(1000, 0);
+	    threadpool::parallel::for_each<4>(v, [](int& e){ ++e; });
+	    for (int e: v)
+		BOOST_CHECK_EQUAL(e, 1);
+	}
+	{ // Per-call latency of the borrowed-pool path
+	    std::vector<int> v(100, 0);
+	    const int calls = 1000;
+	    Clock::time_point t0 = Clock::now();
+	    for (int i = 0; i < calls; ++i)
+		threadpool::parallel::for_each(v, [](int& e){ ++e; });
+	    Clock::time_point t1 = Clock::now();
+	    double d = duration_in_microseconds(t0, t1) / calls;
+	    std::cout << "shared_pool_tests parallel::for_each(100 elements) = "
+		      << d << " us" << std::endl;
+	}
+    }
+
+    template<class C>
+    static void reduce_tests()
+    {
+	{ // Sum of an integer vector
+	    std::vector<int> v(100000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = i % 1000;
+	    long expected = 0;
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		expected += v[i];
+	    long r = C::parallel_reduce(v, 0L,
+					[](long a, int e) -> long { return a + e; },
+					[](long a, long b) -> long { return a + b; });
+	    BOOST_CHECK_EQUAL(r, expected);
+	}
+	{ // Maximum over an integral range
+	    int r = C::parallel_reduce(0, 100000u, 0,
+				       [](int a, int i) -> int { return i > a ? i : a; },
+				       [](int a, int b) -> int { return b > a ? b : a; });
+	    BOOST_CHECK_EQUAL(r, 99999);
+	}
+	{ // Forward iterators take the single-object queue
+	    std::list<int> l(1000, 2);
+	    int r = C::parallel_reduce(l.begin(), l.end(), 0,
+				       [](int a, int e) -> int { return a + e; },
+				       [](int a, int b) -> int { return a + b; });
+	    BOOST_CHECK_EQUAL(r, 2000);
+	}
+	{ // Empty range yields the start value
+	    std::vector<int> v;
+	    int r = C::parallel_reduce(v, 42,
+				       [](int a, int e) -> int { return a + e; },
+				       [](int a, int b) -> int { return a + b; });
+	    BOOST_CHECK_EQUAL(r, 42);
+	}
+    }
+
+    struct parallel_reduce_tests_helper {
+	template<class A, class B, class C, class D>
+	static typename std::decay<B>::type parallel_reduce(A&&a,B&&b,C&&c,D&&d)
+	{ return threadpool::parallel::reduce(std::forward<A>(a),std::forward<B>(b),std::forward<C>(c),std::forward<D>(d)); }
+	template<class A, class E, class B, class C, class D>
+	static typename std::decay<B>::type parallel_reduce(A&&a,E&&e,B&&b,C&&c,D&&d)
+	{ return threadpool::parallel::reduce(std::forward<A>(a),std::forward<E>(e),std::forward<B>(b),std::forward<C>(c),std::forward<D>(d)); }
+    };
+
+    BOOST_AUTO_TEST_CASE(parallel_reduce_tests)
+    {
+	reduce_tests<parallel_reduce_tests_helper>();
+    }
+
+    struct singlethreaded_reduce_tests_helper {
+	template<class A, class B, class C, class D>
+	static typename std::decay<B>::type parallel_reduce(A&&a,B&&b,C&&c,D&&d)
+	{ return threadpool::singlethreaded::parallel::reduce(std::forward<A>(a),std::forward<B>(b),std::forward<C>(c),std::forward<D>(d)); }
+	template<class A, class E, class B, class C, class D>
+	static typename std::decay<B>::type parallel_reduce(A&&a,E&&e,B&&b,C&&c,D&&d)
+	{ return threadpool::singlethreaded::parallel::reduce(std::forward<A>(a),std::forward<E>(e),std::forward<B>(b),std::forward<C>(c),std::forward<D>(d)); }
+    };
+
+    BOOST_AUTO_TEST_CASE(singlethreaded_reduce_tests)
+    {
+	reduce_tests<singlethreaded_reduce_tests_helper>();
+    }
+
+    template<class C>
+    static void sort_tests()
+    {
+	{ // Large scrambled vector, default comparison
+	    std::vector<int> v(100000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = (i * 2654435761u) % 100000;
+	    std::vector<int> expected(v);
+	    std::sort(expected.begin(), expected.end());
+	    C::parallel_sort(v);
+	    BOOST_CHECK(v == expected);
+	}
+	{ // Custom comparison, descending
+	    std::vector<int> v(10000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = (i * 40503u) % 10000;
+	    C::parallel_sort(v, [](int a, int b) { return b < a; });
+	    BOOST_CHECK(std::is_sorted(v.begin(), v.end(),
+				       [](int a, int b) { return b < a; }));
+	}
+	{ // Iterator range
+	    std::vector<int> v(10000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = (i * 48271u) % 10000;
+	    C::parallel_sort(v.begin(), v.end());
+	    BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+	}
+	{ // Already sorted input stays sorted
+	    std::vector<int> v(10000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = i;
+	    C::parallel_sort(v);
+	    BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+	}
+	{ // Empty and single-element ranges
+	    std::vector<int> e;
+	    C::parallel_sort(e);
+	    BOOST_CHECK(e.empty());
+	    std::vector<int> s(1, 7);
+	    C::parallel_sort(s);
+	    BOOST_CHECK_EQUAL(s[0], 7);
+	}
+    }
+
+    struct parallel_sort_tests_helper {
+	// Explicit thread count and a large maxpart: a dedicated
+	// pool with many small runs, stressing the run merging.
+	template<class... A>
+	static void parallel_sort(A&&... a)
+	{ threadpool::parallel::sort<4, 13>(std::forward<A>(a)...); }
+    };
+
+    BOOST_AUTO_TEST_CASE(parallel_sort_tests)
+    {
+	sort_tests<parallel_sort_tests_helper>();
+	{ // Default thread count borrows the shared pool
+	    std::vector<int> v(10000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = (i * 69621u) % 10000;
+	    threadpool::parallel::sort(v);
+	    BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+	}
+	{ // min_chunk bounds the size of the sorted runs below
+	    std::vector<int> v(10000);
+	    for (unsigned int i = 0; i < v.size(); ++i)
+		v[i] = (i * 16807u) % 10000;
+	    threadpool::parallel::sort<4, 100, 500>(v);
+	    BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+	}
+    }
+
+    struct singlethreaded_sort_tests_helper {
+	template<class... A>
+	static void parallel_sort(A&&... a)
+	{ threadpool::singlethreaded::parallel::sort(std::forward<A>(a)...); }
+    };
+
+    BOOST_AUTO_TEST_CASE(singlethreaded_sort_tests)
+    {
+	sort_tests<singlethreaded_sort_tests_helper>();
+    }
+
     struct parallel_transform_tests_helper {
 	template<class A, class B, class C>
 	static typename std::remove_reference<B>::type parallel_transform(A&&a,B&&b,C&&c)
@@ -631,6 +1356,21 @@ namespace threadpool_test {
     BOOST_AUTO_TEST_CASE(parallel_transform_tests)
     {
 	transform_tests<parallel_transform_tests_helper>();
+	{ // Ordered chunk merge in the generic queue under contention
+	    std::vector<int> in(100000);
+	    for (unsigned int i = 0; i < in.size(); ++i)
+		in[i] = i;
+	    std::vector<int> out;
+	    threadpool::parallel::transform(in.begin(), in.end(),
+					    std::back_inserter(out),
+					    [](int x) { return 2 * x; });
+	    BOOST_CHECK_EQUAL(out.size(), in.size());
+	    bool ordered = true;
+	    for (unsigned int i = 0; i < out.size(); ++i)
+		if (out[i] != 2 * static_cast<int>(i))
+		    ordered = false;
+	    BOOST_CHECK(ordered);
+	}
     }
 
     struct singlethreaded_transform_tests_helper {
@@ -679,6 +1419,484 @@ namespace threadpool_test {
 	homogenousFunctionTests<Pool>();
     }
 
+#if THREADPOOL_HAVE_LOCKFREE_QUEUE
+    BOOST_AUTO_TEST_CASE(impl_lockfree_homogenous_tests)
+    {
+	typedef ThreadPoolImpl::impl::LockfreeHomogenousThreadPool<std::function<void()> > Pool;
+	homogenousFunctionTests<Pool>();
+    }
+#endif
+
+#if THREADPOOL_HAVE_SINGLEPRODUCER_QUEUE
+    BOOST_AUTO_TEST_CASE(impl_singleproducer_homogenous_tests)
+    {
+	typedef ThreadPoolImpl::impl::SingleProducerHomogenousThreadPool<std::function<void()> > Pool;
+	homogenousFunctionTests<Pool>();
+	{ // A tiny capacity bound exercises the full-ring path
+	    Pool pool(2, 8);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 10000; ++i)
+		pool.run([&count](){ ++count; });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 10000);
+	}
+    }
+#endif
+
+    BOOST_AUTO_TEST_CASE(impl_workstealing_homogenous_tests)
+    {
+	typedef ThreadPoolImpl::impl::WorkStealingHomogenousThreadPool<std::function<void()> > Pool;
+	homogenousFunctionTests<Pool>();
+	{ // Recursive submission from inside a task uses the local deque
+	    Pool pool;
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 100; ++i)
+		pool.run([&pool,&count](){
+			++count;
+			for (int j = 0; j < 10; ++j)
+			    pool.run([&count](){ ++count; });
+		    });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1100);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(statistics_tests)
+    {
+	threadpool::ThreadPool pool(2);
+	{ // Fresh pool: counters at zero, capacity at the default
+	    threadpool::ThreadPoolStatistics s = pool.statistics();
+	    BOOST_CHECK_EQUAL(s.queue_depth, 0u);
+	    BOOST_CHECK_EQUAL(s.queue_capacity, 10000u);
+	    BOOST_CHECK_EQUAL(s.tasks_executed, 0ull);
+	}
+	std::atomic<int> count(0);
+	for (int i = 0; i < 1000; ++i)
+	    pool.run([&count](){ ++count; });
+	pool.run([](){
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	    });
+	pool.wait();
+	BOOST_CHECK_EQUAL(count.load(), 1000);
+	// All workers are idle now, so this put() must signal a wakeup.
+	pool.run([&count](){ ++count; });
+	pool.wait();
+	threadpool::ThreadPoolStatistics s = pool.statistics();
+	BOOST_CHECK_EQUAL(s.queue_depth, 0u);
+	BOOST_CHECK_EQUAL(s.tasks_executed, 1002ull);
+	BOOST_CHECK(s.max_queue_depth >= 1);
+	BOOST_CHECK(s.max_queue_depth <= s.queue_capacity);
+	BOOST_CHECK(s.wakeups >= 1);
+	BOOST_CHECK_EQUAL(s.idle_workers, s.total_workers);
+	unsigned long long histogram_sum = 0;
+	for (unsigned int i = 0;
+	     i != threadpool::ThreadPoolStatistics::histogram_buckets; ++i)
+	    histogram_sum += s.execution_time_histogram[i];
+	BOOST_CHECK_EQUAL(histogram_sum, s.tasks_executed);
+	// The 3ms sleeper must land in a bucket of at least 2^12us.
+	unsigned long long slow = 0;
+	for (unsigned int i = 12;
+	     i != threadpool::ThreadPoolStatistics::histogram_buckets; ++i)
+	    slow += s.execution_time_histogram[i];
+	BOOST_CHECK(slow >= 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(executor_tests)
+    {
+	{ // execute() submits to the pool; copies compare equal
+	    threadpool::ThreadPool pool(4);
+	    threadpool::Executor ex = threadpool::make_executor(pool);
+	    threadpool::Executor ex2 = ex;
+	    BOOST_CHECK(ex == ex2);
+	    threadpool::ThreadPool other(2);
+	    BOOST_CHECK(ex != threadpool::make_executor(other));
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 1000; ++i)
+		ex.execute([&count]() { ++count; });
+	    ex.execute(threadpool::Priority::high, [&count]() { ++count; });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1001);
+	}
+	{ // The scheduler shim completes a receiver on a pool thread
+	    struct Receiver {
+		std::atomic<int>* completions;
+		void set_value() { ++*completions; }
+		void set_error(std::exception_ptr) { *completions = -1; }
+	    };
+	    threadpool::ThreadPool pool(2);
+	    threadpool::Scheduler scheduler = threadpool::make_scheduler(pool);
+	    BOOST_CHECK(scheduler == threadpool::make_scheduler(pool));
+	    std::atomic<int> completions(0);
+	    auto operation = scheduler.schedule().connect(Receiver{&completions});
+	    operation.start();
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(completions.load(), 1);
+	}
+	{ // An exception leaving set_value() arrives at set_error()
+	    struct ThrowingReceiver {
+		std::atomic<int>* errors;
+		void set_value() { throw std::runtime_error("receiver"); }
+		void set_error(std::exception_ptr e) {
+		    try {
+			std::rethrow_exception(e);
+		    } catch (std::runtime_error&) {
+			++*errors;
+		    }
+		}
+	    };
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<int> errors(0);
+	    auto operation = threadpool::make_scheduler(pool)
+		.schedule().connect(ThrowingReceiver{&errors});
+	    operation.start();
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(errors.load(), 1);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(quiescence_tests)
+    {
+	{ // pending() tracks queued and executing tasks
+	    threadpool::ThreadPool pool(4);
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	    std::atomic<int> sum(0);
+	    std::atomic<int> started(0);
+	    std::mutex m;
+	    std::condition_variable cv;
+	    bool go = false;
+	    for (int i = 0; i < 4; ++i)
+		pool.run([&]() {
+			++started;
+			std::unique_lock<std::mutex> lock(m);
+			while (!go)
+			    cv.wait(lock);
+			++sum;
+		    });
+	    while (started != 4)
+		std::this_thread::yield();
+	    // All four are executing: still pending, no longer queued
+	    BOOST_CHECK_EQUAL(pool.pending(), 4u);
+	    {
+		std::lock_guard<std::mutex> lock(m);
+		go = true;
+	    }
+	    cv.notify_all();
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	    BOOST_CHECK_EQUAL(sum.load(), 4);
+	}
+	{ // Draining many small tasks reaches quiescence exactly once
+	    threadpool::ThreadPool pool(4);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 100000; ++i)
+		pool.run([&count]() { ++count; });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 100000);
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	    // wait() on a quiescent pool returns immediately
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	}
+	{ // Batch submission is counted like individual put()s
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<int> count(0);
+	    std::vector<std::function<void()> > batch;
+	    for (int i = 0; i < 1000; ++i)
+		batch.push_back([&count]() { ++count; });
+	    pool.run_batch(batch.begin(), batch.end());
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	}
+	{ // Tasks discarded by join() are finished for wait()ers too
+	    threadpool::ThreadPool pool(2);
+	    pool.run([]() { });
+	    pool.wait();
+	    pool.join();
+	    BOOST_CHECK_EQUAL(pool.pending(), 0u);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(thread_options_tests)
+    {
+	{ // Per-worker start callback runs once per worker
+	    threadpool::ThreadOptions options;
+	    std::atomic<int> started(0);
+	    options.at_thread_start = [&started](unsigned int){ ++started; };
+	    std::atomic<int> count(0);
+	    {
+		threadpool::ThreadPool pool(4, 0, 1, options);
+		for (int i = 0; i < 100; ++i)
+		    pool.run([&count](){ ++count; });
+		pool.wait();
+		BOOST_CHECK_EQUAL(count.load(), 100);
+	    } // Only after join() have all workers run the callback
+	    BOOST_CHECK_EQUAL(started.load(), 4);
+	}
+#ifdef __linux__
+	{ // Workers are pinned before the start callback runs
+	    threadpool::ThreadOptions options;
+	    options.cpus.push_back(0);
+	    std::atomic<int> wrong(0);
+	    options.at_thread_start = [&wrong](unsigned int){
+		if (sched_getcpu() != 0)
+		    ++wrong;
+	    };
+	    {
+		threadpool::ThreadPool pool(2, 0, 1, options);
+		pool.run([](){});
+		pool.wait();
+	    }
+	    BOOST_CHECK_EQUAL(wrong.load(), 0);
+	}
+#endif
+    }
+
+    BOOST_AUTO_TEST_CASE(impl_numa_tests)
+    {
+	const ThreadPoolImpl::impl::NumaTopology& topology =
+	    ThreadPoolImpl::impl::NumaTopology::instance();
+	BOOST_CHECK(topology.node_count() >= 1);
+	unsigned int total = 0;
+	for (unsigned int n = 0; n != topology.node_count(); ++n) {
+	    BOOST_CHECK(!topology.node_cpus(n).empty());
+	    total += topology.node_thread_count(n, 7);
+	}
+	BOOST_CHECK_EQUAL(total, 7u);
+	BOOST_CHECK(topology.current_node() < topology.node_count());
+
+	typedef ThreadPoolImpl::impl::NumaThreadPool<std::function<void()> > Pool;
+	homogenousFunctionTests<Pool>();
+    }
+
+    BOOST_AUTO_TEST_CASE(run_batch_tests)
+    {
+	{ // Batch submission into the homogenous pool
+	    typedef ThreadPoolImpl::impl::HomogenousThreadPool<std::function<void()> > Pool;
+	    Pool pool;
+	    std::atomic<int> count(0);
+	    std::vector<std::function<void()> > batch;
+	    for (int i = 0; i < 1000; ++i)
+		batch.push_back([&count](){ ++count; });
+	    pool.run_batch(batch.begin(), batch.end());
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+	{ // Batch larger than the queue exercises the backpressure path
+	    typedef ThreadPoolImpl::impl::HomogenousThreadPool<std::function<void()> > Pool;
+	    Pool pool(-1, 100);
+	    std::atomic<int> count(0);
+	    std::vector<std::function<void()> > batch;
+	    for (int i = 0; i < 1000; ++i)
+		batch.push_back([&count](){ ++count; });
+	    pool.run_batch(batch.begin(), batch.end());
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+	{ // Batch submission through the virtual pool
+	    threadpool::ThreadPool pool;
+	    std::atomic<int> count(0);
+	    std::vector<std::function<void()> > batch;
+	    for (int i = 0; i < 1000; ++i)
+		batch.push_back([&count](){ ++count; });
+	    pool.run_batch(batch.begin(), batch.end());
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(task_arena_tests)
+    {
+	typedef ThreadPoolImpl::impl::TaskArena Arena;
+	{ // Freed blocks of the same size class are reused
+	    void* a = Arena::allocate(40);
+	    Arena::deallocate(a);
+	    void* b = Arena::allocate(64);
+	    BOOST_CHECK_EQUAL(a, b);
+	    Arena::deallocate(b);
+	}
+	{ // Oversize blocks fall through to the heap
+	    void* p = Arena::allocate(4096);
+	    BOOST_CHECK(p != nullptr);
+	    Arena::deallocate(p);
+	}
+	{ // Heap tasks (captures too large for the inline slot) recycle
+	    threadpool::ThreadPool pool;
+	    std::array<int, 32> big;
+	    big.fill(1);
+	    std::atomic<int> count(0);
+	    for (int i = 0; i < 1000; ++i)
+		pool.run([big,&count](){ count += big[0]; });
+	    pool.wait();
+	    BOOST_CHECK_EQUAL(count.load(), 1000);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(light_future_tests)
+    {
+	typedef threadpool::ThreadPool Pool;
+	{ // Result round trip
+	    Pool pool;
+	    volatile int i = 1;
+	    threadpool::Future<int> f = pool.run_future([&i]()->int{ return i * 3; });
+	    BOOST_CHECK(f.valid());
+	    BOOST_CHECK_EQUAL(f.get(), 3);
+	    BOOST_CHECK(!f.valid());
+	}
+	{ // Exceptions from the task are rethrown by get()
+	    Pool pool;
+	    auto f = pool.run_future([]()->int{ throw std::runtime_error("boom"); });
+	    BOOST_CHECK_THROW(f.get(), std::runtime_error);
+	}
+	{ // Discarded tasks leave a broken promise behind
+	    Pool pool(0);
+	    auto f = pool.run_future([]()->int{ return 1; });
+	    pool.join();
+	    BOOST_CHECK_THROW(f.get(), std::future_error);
+	}
+	{ // Many futures in flight recycle their shared states
+	    Pool pool;
+	    std::vector<threadpool::Future<int> > futures;
+	    for (int i = 0; i < 1000; ++i)
+		futures.push_back(pool.run_future([i]()->int{ return i; }));
+	    for (int i = 0; i < 1000; ++i)
+		BOOST_CHECK_EQUAL(futures[i].get(), i);
+	}
+	{ // Timing comparison with the std::future overload
+	    Pool pool;
+	    typedef std::chrono::high_resolution_clock clock;
+	    int n = 100000;
+	    auto t0 = clock::now();
+	    for (int i = 0; i < n; ++i)
+		pool.run_future([]()->int{ return 1; }).get();
+	    auto t1 = clock::now();
+	    std::cout << "light_future_tests run_future().get() = "
+		      << std::chrono::duration<double, std::micro>(t1 - t0).count() / n
+		      << " us" << std::endl;
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(continuation_tests)
+    {
+	{ // then() chains carry the value without a wait() barrier
+	    threadpool::ThreadPool pool(2);
+	    auto f = pool.run_future([](){ return 7; })
+		.then(pool, [](int x){ return x * 3; })
+		.then(pool, [](int x){ return x + 1; });
+	    BOOST_CHECK_EQUAL(f.get(), 22);
+	}
+	{ // A void continuation ends a chain
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<int> result(0);
+	    std::atomic<bool> done(false);
+	    pool.run_future([](){ return 5; })
+		.then(pool, [&result, &done](int x){ result = x; done = true; });
+	    while (!done.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    BOOST_CHECK_EQUAL(result.load(), 5);
+	    pool.wait();
+	}
+	{ // then() on an already published result fires immediately
+	    threadpool::ThreadPool pool(2);
+	    auto f = pool.run_future([](){ return 1; });
+	    f.wait();
+	    auto g = f.then(pool, [](int x){ return x + 41; });
+	    BOOST_CHECK_EQUAL(g.get(), 42);
+	}
+	{ // An exception travels down the chain to the final get()
+	    threadpool::ThreadPool pool(2);
+	    auto f = pool.run_future([]() -> int { throw std::runtime_error("first"); })
+		.then(pool, [](int x){ return x + 1; });
+	    BOOST_CHECK_THROW(f.get(), std::runtime_error);
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(dependency_tests)
+    {
+	{ // run() predecessors count the successor's gate down
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<int> count(0);
+	    std::atomic<bool> fired(false);
+	    threadpool::Dependency dep(pool, 3, [&fired](){ fired = true; });
+	    for (int i = 0; i != 3; ++i)
+		dep.run([&count](){ ++count; });
+	    while (!fired.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    BOOST_CHECK_EQUAL(count.load(), 3);
+	    pool.wait();
+	}
+	{ // Diamond graph without any pool-wide barrier
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<int> left(0);
+	    std::atomic<int> right(0);
+	    std::atomic<int> sum(-1);
+	    std::atomic<bool> done(false);
+	    threadpool::Dependency sink(pool, 2, [&](){
+		    sum = left + right;
+		    done = true;
+		});
+	    threadpool::Dependency lgate(pool, 1, [&left, sink]() mutable {
+		    left = 1;
+		    sink.satisfy();
+		});
+	    threadpool::Dependency rgate(pool, 1, [&right, sink]() mutable {
+		    right = 2;
+		    sink.satisfy();
+		});
+	    pool.run([lgate, rgate]() mutable { // The source fans out
+		    lgate.satisfy();
+		    rgate.satisfy();
+		});
+	    while (!done.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	    BOOST_CHECK_EQUAL(sum.load(), 3);
+	    pool.wait();
+	}
+	{ // A zero-predecessor successor runs immediately
+	    threadpool::ThreadPool pool(2);
+	    std::atomic<bool> fired(false);
+	    threadpool::Dependency dep(pool, 0, [&fired](){ fired = true; });
+	    pool.wait();
+	    BOOST_CHECK(fired.load());
+	}
+    }
+
+#if THREADPOOL_HAVE_COROUTINES
+    namespace coroutine_test {
+
+	struct FireAndForget {
+	    struct promise_type {
+		FireAndForget get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() { }
+		void unhandled_exception() { std::terminate(); }
+	    };
+	};
+
+	FireAndForget fan_out(threadpool::ThreadPool& pool,
+			      std::atomic<int>& result,
+			      std::atomic<int>& done) {
+	    co_await threadpool::schedule(pool);
+	    auto f1 = threadpool::async(pool, []{ return 40; });
+	    auto f2 = threadpool::async(pool, []{ return 2; });
+	    result = co_await std::move(f1) + co_await std::move(f2);
+	    ++done;
+	}
+    }
+
+    BOOST_AUTO_TEST_CASE(coroutine_tests)
+    {
+	threadpool::ThreadPool pool(2);
+	std::atomic<int> result(0), done(0);
+	coroutine_test::fan_out(pool, result, done);
+	while (done.load() != 1)
+	    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	pool.wait();
+	BOOST_CHECK_EQUAL(result.load(), 42);
+    }
+#endif // THREADPOOL_HAVE_COROUTINES
+
     BOOST_AUTO_TEST_CASE(ThreadPool_tests)
     {
 	//typedef ThreadPoolTemplate<-1, 100> Pool; // Smaller queue stresses wrap-around